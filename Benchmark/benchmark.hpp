@@ -0,0 +1,210 @@
+#pragma once
+
+#include "../ClusterV1/stopwatch.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// synthetic data sets and the report shared by the ClusterV1 and ClusterV2 benchmarks
+// the two versions both use namespace cluster with different types, so each is benchmarked by its own executable
+// nothing here depends on either version
+namespace benchmark
+{
+	//======= TYPE DEFINITIONS ====================
+
+	constexpr uint64_t BENCHMARK_SEED = 42; // every data set and clustering run is seeded from this
+
+
+	typedef struct Workload
+	{
+		size_t num_rows;
+		size_t dimension;    // values in each row, or chars in each string
+		size_t num_clusters; // blobs generated and clusters searched for
+
+	} workload_t;
+
+
+	// seconds spent in each phase of clustering, summed over iterations and attempts
+	// negative when the engine does not report its phases
+	typedef struct PhaseTimes
+	{
+		double seeding = -1;
+		double assignment = -1;  // assignment and centroid update, the cluster totals are added up while rows are assigned
+		double convergence = -1; // convergence checks, swapping buffers and relabelling
+
+	} phase_times_t;
+
+
+	typedef struct ReportRow
+	{
+		std::string engine;
+		workload_t workload;
+		long long attempts = 1;    // negative when set by the library's configuration
+		double seconds = 0;
+		long long iterations = -1; // assignment passes over the data in all attempts, negative when not known
+		phase_times_t phases;
+		double average_distance = 0;
+
+	} report_row_t;
+
+
+	//======= WORKLOADS ============================
+
+	// every combination of the given sizes
+	inline std::vector<workload_t> make_workloads(std::vector<size_t> const& rows, std::vector<size_t> const& dimensions, std::vector<size_t> const& clusters)
+	{
+		std::vector<workload_t> list;
+
+		for (auto const n : rows)
+		{
+			for (auto const d : dimensions)
+			{
+				for (auto const k : clusters)
+					list.push_back({ n, d, k });
+			}
+		}
+
+		return list;
+	}
+
+
+	// --quick runs small sizes, e.g. to check the benchmark still runs
+	inline bool is_quick(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "--quick") == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+
+	//======= DATA SETS ============================
+
+	// num_clusters gaussian blobs, rows stored one after the other
+	// centres are uniform in [-scale, scale], each value of a row is its centre plus normal noise of the given spread
+	inline std::vector<double> gaussian_blobs(workload_t const& workload, double scale = 100, double spread = 10, uint64_t seed = BENCHMARK_SEED)
+	{
+		std::mt19937_64 gen{ seed };
+		std::uniform_real_distribution<double> uniform(-scale, scale);
+		std::normal_distribution<double> noise(0, spread);
+
+		const auto d = workload.dimension;
+		std::vector<double> centres(workload.num_clusters * d);
+		for (auto& value : centres)
+			value = uniform(gen);
+
+		std::uniform_int_distribution<size_t> pick(0, workload.num_clusters - 1);
+		std::vector<double> rows(workload.num_rows * d);
+
+		for (size_t i = 0; i < workload.num_rows; ++i)
+		{
+			const auto c = pick(gen);
+			for (size_t j = 0; j < d; ++j)
+				rows[i * d + j] = centres[c * d + j] + noise(gen);
+		}
+
+		return rows;
+	}
+
+
+	// num_clusters random strings over the alphabet, each row is one of them with every char replaced at the given rate
+	inline std::vector<std::string> string_blobs(workload_t const& workload, std::string const& alphabet = "ACGT", double mutation = 0.1, uint64_t seed = BENCHMARK_SEED)
+	{
+		std::mt19937_64 gen{ seed };
+		std::uniform_int_distribution<size_t> letter(0, alphabet.size() - 1);
+		std::uniform_real_distribution<double> uniform(0, 1);
+
+		std::vector<std::string> centres(workload.num_clusters, std::string(workload.dimension, ' '));
+		for (auto& centre : centres)
+		{
+			for (auto& c : centre)
+				c = alphabet[letter(gen)];
+		}
+
+		std::uniform_int_distribution<size_t> pick(0, workload.num_clusters - 1);
+		std::vector<std::string> rows(workload.num_rows);
+
+		for (auto& row : rows)
+		{
+			row = centres[pick(gen)];
+			for (auto& c : row)
+			{
+				if (uniform(gen) < mutation)
+					c = alphabet[letter(gen)];
+			}
+		}
+
+		return rows;
+	}
+
+
+	//======= REPORT ===============================
+
+	inline void print_header()
+	{
+		std::printf("%-24s %9s %5s %6s %4s %9s %6s %9s %13s %9s %10s %12s\n",
+			"engine", "rows", "dim", "k", "att", "seconds", "iters", "seeding", "assign+update", "converge", "Mpc/s", "avg distance");
+	}
+
+
+	// throughput is rows * clusters * iterations per second (point-centroid pairs), only when the iterations are known
+	inline void print_row(report_row_t const& row)
+	{
+		auto const phase = [](double seconds, int width, char* text)
+		{
+			if (seconds < 0)
+				std::snprintf(text, 24, "%*s", width, "-");
+			else
+				std::snprintf(text, 24, "%*.4f", width, seconds);
+		};
+
+		char attempts[24], seeding[24], assignment[24], convergence[24], iterations[24], throughput[24];
+		if (row.attempts < 0)
+			std::snprintf(attempts, sizeof(attempts), "%4s", "cfg");
+		else
+			std::snprintf(attempts, sizeof(attempts), "%4lld", row.attempts);
+
+		phase(row.phases.seeding, 9, seeding);
+		phase(row.phases.assignment, 13, assignment);
+		phase(row.phases.convergence, 9, convergence);
+
+		if (row.iterations < 0)
+		{
+			std::snprintf(iterations, sizeof(iterations), "%6s", "-");
+			std::snprintf(throughput, sizeof(throughput), "%10s", "-");
+		}
+		else
+		{
+			const auto pairs = static_cast<double>(row.workload.num_rows) * row.workload.num_clusters * row.iterations;
+			std::snprintf(iterations, sizeof(iterations), "%6lld", row.iterations);
+			std::snprintf(throughput, sizeof(throughput), "%10.1f", row.seconds > 0 ? pairs / row.seconds / 1e6 : 0.0);
+		}
+
+		std::printf("%-24s %9zu %5zu %6zu %s %9.4f %s %s %s %s %s %12.4f\n",
+			row.engine.c_str(), row.workload.num_rows, row.workload.dimension, row.workload.num_clusters, attempts,
+			row.seconds, iterations, seeding, assignment, convergence, throughput, row.average_distance);
+
+		std::fflush(stdout);
+	}
+
+
+	// runs f() and returns its time in seconds
+	template<typename F>
+	double time_seconds(F&& f)
+	{
+		Stopwatch sw;
+		sw.start();
+		f();
+		sw.stop();
+
+		return sw.get_time_sec();
+	}
+}
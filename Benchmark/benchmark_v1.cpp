@@ -0,0 +1,79 @@
+// ClusterV1 engines on strings and on gaussian blobs rounded to chars
+// build: g++ -O2 -std=c++17 -pthread benchmark_v1.cpp ../ClusterV1/cluster.cpp -o benchmark_v1
+// run:   ./benchmark_v1 [--quick]
+// attempts, threads, seeding and algorithm come from ClusterV1/cluster_config.hpp, set CLUSTER_SEED for repeatable results
+// ClusterV1 does not report its phases or iterations, only the total time of each call is measured
+
+#include "benchmark.hpp"
+
+#include "../ClusterV1/cluster.hpp"
+
+#include <algorithm>
+
+using namespace benchmark;
+
+
+//======= DATA SETS =================================
+
+// blob values are rounded to chars, so the blobs are kept small enough to fit
+static cluster::data_row_list_t char_blobs(workload_t const& workload)
+{
+	const auto values = gaussian_blobs(workload, 50, 5);
+
+	cluster::data_row_list_t rows(workload.num_rows, cluster::data_row_t(workload.dimension, 0));
+	for (size_t i = 0; i < workload.num_rows; ++i)
+	{
+		for (size_t j = 0; j < workload.dimension; ++j)
+			rows[i][j] = static_cast<char>(std::clamp(std::round(values[i * workload.dimension + j]), -127.0, 127.0));
+	}
+
+	return rows;
+}
+
+
+//======= ENGINES ===================================
+
+template<typename F>
+report_row_t run_engine(std::string const& engine, workload_t const& workload, F const& cluster_data)
+{
+	report_row_t row;
+	row.engine = engine;
+	row.workload = workload;
+	row.attempts = -1;
+
+	cluster::cluster_result_t result;
+	row.seconds = time_seconds([&]() { result = cluster_data(); });
+	row.average_distance = result.average_distance;
+
+	return row;
+}
+
+
+void run_workload(workload_t const& workload)
+{
+	const auto blobs = char_blobs(workload);
+	const auto k = workload.num_clusters;
+
+	print_row(run_engine("blobs min_distance", workload, [&]() { return cluster::cluster_min_distance(blobs, k); }));
+	print_row(run_engine("blobs max_count", workload, [&]() { return cluster::cluster_max_count(blobs, k); }));
+
+	const auto strings = string_blobs(workload);
+
+	print_row(run_engine("strings min_distance", workload, [&]() { return cluster::cluster_min_distance(strings, k); }));
+	print_row(run_engine("strings modes", workload, [&]() { return cluster::cluster_modes(strings, k); }));
+}
+
+
+int main(int argc, char* argv[])
+{
+	const auto workloads = is_quick(argc, argv)
+		? make_workloads({ 1000 }, { 8 }, { 4 })
+		: make_workloads({ 2000, 10000 }, { 8, 32 }, { 4, 16 });
+
+	print_header();
+
+	for (auto const& workload : workloads)
+		run_workload(workload);
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+// ClusterV2 engines on gaussian blobs
+// build: g++ -O2 -std=c++17 -pthread -I../ClusterV2 benchmark_v2.cpp ../ClusterV2/cluster.cpp ../ClusterV2/distance.cpp ../ClusterV2/dataset.cpp -o benchmark_v2
+// run:   ./benchmark_v2 [--quick]
+// every engine runs one attempt seeded with k-means++ on one thread, so the times can be compared from run to run
+
+#include "benchmark.hpp"
+
+#include "cluster.hpp"
+
+using namespace benchmark;
+using namespace cluster;
+
+
+//======= PHASED LLOYD ==============================
+
+// the same steps as algorithms::cluster_once with each phase timed
+// seeded as the first attempt of BasicCluster, so it should find the same clusters as the lloyd row
+template<typename D>
+report_row_t run_phased(std::string const& engine, workload_t const& workload, data_view_t const& x_list, D const& distance, ThreadPool& pool)
+{
+	using namespace cluster::algorithms;
+
+	const auto num_clusters = workload.num_clusters;
+	const auto num_data = x_list.size();
+
+	report_row_t row;
+	row.engine = engine;
+	row.workload = workload;
+	row.phases = { 0, 0, 0 };
+	row.iterations = 0;
+
+	auto& phases = row.phases;
+	Stopwatch sw;
+
+	auto const timed = [&](double& total, auto&& f)
+	{
+		sw.start();
+		f();
+		sw.stop();
+		total += sw.get_time_sec();
+	};
+
+	AttemptWorkspace<matrix_result_t> workspace;
+	auto& result = workspace.result;
+	auto& buffers = workspace.buffers;
+	const Identity identity;
+
+	timed(phases.seeding, [&]()
+	{
+		set_initial_centroids<dynamic_dimension>(x_list, num_clusters, distance, identity, attempt_seed(BENCHMARK_SEED, 0), seeding_t::kmeans_pp, pool, result.centroids, buffers.min_distances);
+	});
+
+	assignment_t assignment = { 0, 0 };
+	timed(phases.assignment, [&]()
+	{
+		result.x_clusters.assign(num_data, num_clusters);
+		assignment = assign_labels<dynamic_dimension>(x_list, result.centroids, distance, identity, pool, result.x_clusters, result.x_clusters, workspace.sums, buffers);
+	});
+	++row.iterations;
+
+	timed(phases.convergence, [&]()
+	{
+		result.average_distance = assignment.total_distance / num_data;
+		workspace.centroids_try = result.centroids;
+		workspace.x_clusters_try.resize(num_data);
+	});
+
+	for (size_t i = 0; i < CLUSTER_ITERATIONS; ++i)
+	{
+		double max_shift = 0;
+		timed(phases.assignment, [&]()
+		{
+			max_shift = update_centroids<dynamic_dimension>(workspace.sums, result.centroids, workspace.centroids_try);
+		});
+
+		if (max_shift <= CLUSTER_TOLERANCE)
+			break;
+
+		timed(phases.assignment, [&]()
+		{
+			assignment = assign_labels<dynamic_dimension>(x_list, workspace.centroids_try, distance, identity, pool, result.x_clusters, workspace.x_clusters_try, workspace.sums_try, buffers);
+		});
+		++row.iterations;
+
+		bool is_done = false;
+		timed(phases.convergence, [&]()
+		{
+			if (has_empty_cluster(workspace.sums_try.counts))
+			{
+				is_done = true;
+				return;
+			}
+
+			std::swap(result.x_clusters, workspace.x_clusters_try);
+			std::swap(result.centroids, workspace.centroids_try);
+			std::swap(workspace.sums, workspace.sums_try);
+			result.average_distance = assignment.total_distance / num_data;
+
+			is_done = !assignment.changed;
+		});
+
+		if (is_done)
+			break;
+	}
+
+	timed(phases.convergence, [&]()
+	{
+		relabel_clusters(result, workspace.sums, num_clusters, buffers);
+	});
+
+	row.seconds = phases.seeding + phases.assignment + phases.convergence;
+	row.average_distance = result.average_distance;
+
+	return row;
+}
+
+
+// lloyd with the blocked kernel for wide rows, as BasicCluster picks it
+report_row_t run_phased(workload_t const& workload, data_view_t const& x_list)
+{
+	static ThreadPool serial(1);
+	const SquaredEuclidean distance;
+
+	if (!algorithms::use_blocked(distance, x_list.dimension()))
+		return run_phased("lloyd phased", workload, x_list, distance, serial);
+
+	// the row norms are part of assignment
+	std::vector<double> norms;
+	Stopwatch sw;
+	sw.start();
+	const algorithms::BlockedDistance<SquaredEuclidean> blocked(distance, x_list, serial, norms);
+	sw.stop();
+
+	auto row = run_phased("lloyd phased (blocked)", workload, x_list, blocked, serial);
+	row.phases.assignment += sw.get_time_sec();
+	row.seconds += sw.get_time_sec();
+
+	return row;
+}
+
+
+//======= ENGINES ===================================
+
+// counts the iterations of the engines that do not report their phases
+class IterationCounter : public ClusterObserver
+{
+public:
+
+	long long iterations = 0;
+
+	void on_iteration(iteration_event_t const&) override { ++iterations; }
+};
+
+
+template<typename C>
+report_row_t run_engine(std::string const& engine, workload_t const& workload, data_view_t const& x_list, C& cluster, algorithm_t algorithm)
+{
+	cluster.set_seed(BENCHMARK_SEED);
+	cluster.set_attempts(1);
+	cluster.set_seeding(seeding_t::kmeans_pp);
+	cluster.set_algorithm(algorithm);
+
+	report_row_t row;
+	row.engine = engine;
+	row.workload = workload;
+
+	matrix_result_t result;
+	row.seconds = time_seconds([&]() { result = cluster.cluster_data(x_list, workload.num_clusters); });
+	row.average_distance = result.average_distance;
+
+	// counted in a second run that is not timed, with an observer elkan and hamerly also calculate the exact distance each iteration
+	// mini_batch iterations are batches, not passes over the data
+	if (algorithm != algorithm_t::mini_batch)
+	{
+		auto counter = std::make_shared<IterationCounter>();
+		cluster.set_observer(counter);
+		cluster.cluster_data(x_list, workload.num_clusters);
+		cluster.set_observer(nullptr);
+
+		row.iterations = counter->iterations;
+	}
+
+	return row;
+}
+
+
+void run_workload(workload_t const& workload)
+{
+	const auto values = gaussian_blobs(workload);
+	const data_view_t x_list(values.data(), workload.num_rows, workload.dimension);
+
+	print_row(run_phased(workload, x_list));
+
+	const std::pair<char const*, algorithm_t> engines[] = {
+		{ "lloyd", algorithm_t::lloyd },
+		{ "elkan", algorithm_t::elkan },
+		{ "hamerly", algorithm_t::hamerly },
+		{ "mini_batch", algorithm_t::mini_batch },
+		{ "approximate", algorithm_t::approximate }
+	};
+
+	for (auto const& engine : engines)
+	{
+		if (engine.second == algorithm_t::approximate && workload.num_clusters < 64)
+			continue; // only meant for many clusters
+
+		BasicCluster<> basic;
+		print_row(run_engine(engine.first, workload, x_list, basic, engine.second));
+	}
+
+	Cluster erased; // runtime metric with the vectorized kernels
+	print_row(run_engine("Cluster lloyd", workload, x_list, erased, algorithm_t::lloyd));
+}
+
+
+int main(int argc, char* argv[])
+{
+	const auto workloads = is_quick(argc, argv)
+		? make_workloads({ 5000 }, { 4, 64 }, { 8, 64 })
+		: make_workloads({ 20000, 100000 }, { 4, 32, 128 }, { 8, 64, 256 });
+
+	print_header();
+
+	for (auto const& workload : workloads)
+		run_workload(workload);
+
+	return 0;
+}
@@ -1,11 +1,34 @@
 #include "cluster_config.hpp"
-#include "stopwatch.hpp"
 
 #include <cstdlib>
 #include <algorithm>
 #include <random>
 #include <iterator>
-#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <climits>
+#include <bitset>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define CLUSTER_BYTES_X86
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+#elif defined(_MSC_VER) && defined(_M_X64)
+
+#include <immintrin.h>
+#include <intrin.h>
+
+#define CLUSTER_BYTES_X86
+#define TARGET_AVX2
+
+#endif
 
 namespace cluster
 {
@@ -19,6 +42,7 @@ namespace cluster
 
 		cluster_result_t result;
 		unsigned count;
+		uint64_t hash; // of the cluster labels
 
 	} cluster_count_t;
 
@@ -46,54 +70,50 @@ namespace cluster
 	}
 
 
-
-	value_row_list_t calc_centroids(data_row_list_t const& x_list, index_list_t const& x_clusters, size_t num_clusters)
+	// returns the largest change of any centroid value
+	// a cluster without data keeps its previous centroid
+	double update_centroids(data_row_list_t const& x_list, index_list_t const& x_clusters, value_row_list_t const& previous, value_row_list_t& next)
 	{
+		const auto num_clusters = previous.size();
 		const auto data_size = x_list[0].size();
-		auto values = make_value_row_list(num_clusters, data_size);
-		
-		
+
 		std::vector<unsigned> counts(num_clusters, 0);
 
+		for (auto& value_row : next)
+			std::fill(value_row.begin(), value_row.end(), 0);
+
 		for (size_t i = 0; i < x_list.size(); ++i)
 		{
 			const auto cluster_index = x_clusters[i];
 			++counts[cluster_index];
 
 			for (size_t d = 0; d < data_size; ++d)
-				values[cluster_index][d] += data_to_value(x_list[i][d]); // totals for each cluster
+				next[cluster_index][d] += data_to_value(x_list[i][d]); // totals for each cluster
 		}
 
+		double max_shift = 0;
 		for (size_t k = 0; k < num_clusters; ++k)
 		{
 			for (size_t d = 0; d < data_size; ++d)
-				values[k][d] = values[k][d] / counts[k]; // convert to average
+			{
+				next[k][d] = counts[k] ? next[k][d] / counts[k] : previous[k][d]; // convert to average
+				max_shift = std::max(max_shift, std::abs(next[k][d] - previous[k][d]));
+			}
 		}
 
-		return values;
+		return max_shift;
 	}
 
-	// re-label cluster assignments so that they are consistent accross iterations
+	// re-label cluster assignments in order of first appearance so that results can be compared
+	// centroids are moved to match the new labels
 	void relabel_clusters(cluster_result_t& result, size_t num_clusters)
 	{
 		std::vector<uint8_t> flags(num_clusters, 0); // tracks if cluster index has been mapped
 		std::vector<size_t> map(num_clusters, 0);    // maps old cluster index to new cluster index
 
-		const auto all_flagged = [&]()
-		{
-			for (auto const flag : flags)
-			{
-				if (!flag)
-					return false;
-			}
-
-			return true;
-		};
-
-		size_t i = 0;
 		size_t label = 0;
 
-		for (; label < num_clusters && i < result.x_clusters.size() && !all_flagged(); ++i)
+		for (size_t i = 0; label < num_clusters && i < result.x_clusters.size(); ++i)
 		{
 			size_t c = result.x_clusters[i];
 			if (flags[c])
@@ -104,36 +124,302 @@ namespace cluster
 			++label;
 		}
 
+		// clusters without data take the remaining labels
+		for (size_t c = 0; c < num_clusters; ++c)
+		{
+			if (!flags[c])
+				map[c] = label++;
+		}
+
 		// re-label cluster assignments
-		for (i = 0; i < result.x_clusters.size(); ++i)
+		for (auto& c : result.x_clusters)
+			c = map[c];
+
+		auto centroids = result.centroids;
+		for (size_t c = 0; c < num_clusters && c < centroids.size(); ++c)
+			result.centroids[map[c]] = std::move(centroids[c]);
+	}
+
+	//======= BYTE DISTANCE =======================
+
+	// rows and centroids as bytes, biased so that chars compare as unsigned and padded with zeros to a multiple of 32
+	// squared differences of bytes are summed exactly in 32 bit integers
+	constexpr uint8_t BYTE_BIAS = std::is_signed_v<char> ? 0x80 : 0;
+	constexpr size_t BYTE_ALIGN = 32;
+
+	typedef struct ByteCentroids {
+		std::vector<uint8_t> values; // centroids rounded to the nearest char
+		size_t stride;               // bytes in each padded row
+
+	} byte_centroids_t;
+
+
+	size_t byte_stride(size_t data_size)
+	{
+		return (data_size + BYTE_ALIGN - 1) / BYTE_ALIGN * BYTE_ALIGN;
+	}
+
+
+	// rows are expected to have data_size chars
+	void to_bytes(data_row_t const& data, size_t data_size, uint8_t* bytes)
+	{
+		const auto size = std::min(data.size(), data_size);
+
+		for (size_t i = 0; i < size; ++i)
+			bytes[i] = static_cast<uint8_t>(data[i]) ^ BYTE_BIAS;
+
+		std::fill(bytes + size, bytes + data_size, uint8_t(0));
+	}
+
+
+	byte_centroids_t quantize(value_row_list_t const& centroids)
+	{
+		const auto data_size = centroids[0].size();
+		byte_centroids_t res = { std::vector<uint8_t>(centroids.size() * byte_stride(data_size), 0), byte_stride(data_size) };
+
+		for (size_t k = 0; k < centroids.size(); ++k)
 		{
-			size_t c = result.x_clusters[i];
-			result.x_clusters[i] = map[c];
+			for (size_t d = 0; d < data_size; ++d)
+			{
+				const auto value = std::min(std::max(std::round(centroids[k][d]), double(CHAR_MIN)), double(CHAR_MAX));
+				res.values[k * res.stride + d] = static_cast<uint8_t>(static_cast<char>(value)) ^ BYTE_BIAS;
+			}
 		}
+
+		return res;
 	}
 
-	cluster_result_t assign_clusters(data_row_list_t const& x_list, value_row_list_t& centroids, size_t num_clusters)  // TODO: remove num_clusters
+
+	uint32_t byte_distance_scalar(uint8_t const* lhs, uint8_t const* rhs, size_t size)
 	{
-		index_list_t x_clusters;
-		x_clusters.reserve(x_list.size());
+		uint32_t sum = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			const int diff = int(lhs[i]) - int(rhs[i]);
+			sum += diff * diff;
+		}
 
-		double total_distance = 0;
+		return sum;
+	}
+
+
+#ifdef CLUSTER_BYTES_X86
+
+	// SSE2 is part of x86-64, 16 bytes at a time
+	uint32_t byte_distance_sse2(uint8_t const* lhs, uint8_t const* rhs, size_t size)
+	{
+		const auto zero = _mm_setzero_si128();
+		auto acc = _mm_setzero_si128();
+
+		for (size_t i = 0; i < size; i += 16)
+		{
+			auto const x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(lhs + i));
+			auto const c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(rhs + i));
+
+			auto const lo = _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(c, zero));
+			auto const hi = _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(c, zero));
+
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo)); // pairs of squares summed into 32 bits
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+		}
+
+		acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+		acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+	}
+
+
+	// 32 bytes at a time
+	TARGET_AVX2
+	uint32_t byte_distance_avx2(uint8_t const* lhs, uint8_t const* rhs, size_t size)
+	{
+		const auto zero = _mm256_setzero_si256();
+		auto acc = _mm256_setzero_si256();
+
+		for (size_t i = 0; i < size; i += 32)
+		{
+			auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(lhs + i));
+			auto const c = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rhs + i));
+
+			auto const lo = _mm256_sub_epi16(_mm256_unpacklo_epi8(x, zero), _mm256_unpacklo_epi8(c, zero));
+			auto const hi = _mm256_sub_epi16(_mm256_unpackhi_epi8(x, zero), _mm256_unpackhi_epi8(c, zero));
+
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(lo, lo));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(hi, hi));
+		}
+
+		auto sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+	}
+
+
+	bool has_avx2()
+	{
+#if defined(_MSC_VER)
+
+		int info[4] = { 0 };
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) // OS saves AVX registers
+			return false;
+
+		__cpuidex(info, 7, 0);
+
+		return (info[1] & (1 << 5)) != 0;
+
+#else
+
+		__builtin_cpu_init();
+
+		return __builtin_cpu_supports("avx2");
+
+#endif
+	}
+
+#endif // CLUSTER_BYTES_X86
+
+
+	using byte_distance_t = uint32_t(*)(uint8_t const* lhs, uint8_t const* rhs, size_t size);
+
+	// best kernel for this cpu, detected once
+	byte_distance_t byte_distance_kernel()
+	{
+#ifdef CLUSTER_BYTES_X86
 
-		for (auto const& x_data : x_list)
+		static const byte_distance_t kernel = has_avx2() ? byte_distance_avx2 : byte_distance_sse2;
+
+		return kernel;
+
+#else
+
+		return byte_distance_scalar;
+
+#endif
+	}
+
+
+	// index of the closest quantized centroid to a padded byte row
+	size_t closest_bytes(uint8_t const* bytes, byte_centroids_t const& centroids, byte_distance_t kernel)
+	{
+		const auto num_centroids = centroids.values.size() / centroids.stride;
+
+		size_t best = 0;
+		uint32_t best_distance = UINT32_MAX;
+
+		for (size_t k = 0; k < num_centroids; ++k)
+		{
+			const auto dist = kernel(bytes, centroids.values.data() + k * centroids.stride, centroids.stride);
+			if (dist < best_distance)
+			{
+				best_distance = dist;
+				best = k;
+			}
+		}
+
+		return best;
+	}
+
+
+	typedef struct Assignment {
+		double total_distance;
+		size_t changed; // rows assigned to a different cluster than before
+		size_t empty;   // clusters without rows
+
+	} assignment_t;
+
+
+	// assigns each row to its closest centroid and compares with the previous assignments
+	// previous and x_clusters can be the same list
+	assignment_t assign_labels(data_row_list_t const& x_list, value_row_list_t const& centroids, index_list_t const& previous, index_list_t& x_clusters)
+	{
+		std::vector<unsigned> counts(centroids.size(), 0);
+		assignment_t res = { 0, 0, 0 };
+
+		const auto add_row = [&](size_t i, size_t index, double dist)
 		{
-			auto c = closest(x_data, centroids);
+			res.changed += previous[i] != index;
+			x_clusters[i] = index;
+			res.total_distance += dist;
+			++counts[index];
+		};
 
-			x_clusters.push_back(c.index);
-			total_distance += c.distance;
+		// rows are compared with the centroids rounded to chars, the distance kept is exact
+		if constexpr (CLUSTER_BYTE_DISTANCE)
+		{
+			const auto byte_values = quantize(centroids);
+			const auto kernel = byte_distance_kernel();
+			std::vector<uint8_t> bytes(byte_values.stride, 0);
+
+			for (size_t i = 0; i < x_list.size(); ++i)
+			{
+				to_bytes(x_list[i], centroids[0].size(), bytes.data());
+				const auto index = closest_bytes(bytes.data(), byte_values, kernel);
+
+				add_row(i, index, value_distance(x_list[i], centroids[index]));
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < x_list.size(); ++i)
+			{
+				auto c = closest(x_list[i], centroids);
+				add_row(i, c.index, c.distance);
+			}
 		}
 
-		cluster_result_t res = { std::move(x_clusters), std::move(centroids), total_distance / x_list.size() };
+		res.empty = std::count(counts.begin(), counts.end(), 0u);
+
 		return res;
 	}
 
 
+	cluster_result_t assign_clusters(data_row_list_t const& x_list, value_row_list_t& centroids)
+	{
+		index_list_t x_clusters(x_list.size(), centroids.size());
+		auto assignment = assign_labels(x_list, centroids, x_clusters, x_clusters);
+
+		cluster_result_t res = { std::move(x_clusters), std::move(centroids), assignment.total_distance / x_list.size() };
+		return res;
+	}
+
+
+
+	// splitmix64, gives well separated seeds for consecutive inputs
+	uint64_t mix_seed(uint64_t value)
+	{
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+		return value ^ (value >> 31);
+	}
+
+	// random seed of a single clustering attempt
+	uint64_t attempt_seed(uint64_t master_seed, size_t attempt)
+	{
+		return mix_seed(master_seed ^ mix_seed(attempt));
+	}
 
-	value_row_list_t random_values(data_row_list_t const& x_list, size_t num_clusters)
+	uint64_t master_seed()
+	{
+		if (CLUSTER_SEED)
+			return CLUSTER_SEED;
+
+		std::random_device rd;
+
+		return (static_cast<uint64_t>(rd()) << 32) | rd();
+	}
+
+
+
+	value_row_list_t random_values(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
 	{
 		// C++ 17 std::sample
 
@@ -141,158 +427,648 @@ namespace cluster
 		samples.reserve(num_clusters);
 
 		std::sample(x_list.begin(), x_list.end(), std::back_inserter(samples),
-			num_clusters, std::mt19937{ std::random_device{}() });
+			num_clusters, std::mt19937_64{ seed });
 
 		return to_value_row_list(samples);
 	}
 
-	size_t max_value(index_list_t const& list)
+	// k-means++, each centroid is a row chosen with probability proportional to its distance from the centroids chosen so far
+	value_row_list_t kmeans_pp_values(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
+	{
+		std::mt19937_64 gen{ seed };
+
+		value_row_list_t values;
+		values.reserve(num_clusters);
+
+		std::vector<double> min_distances(x_list.size(), std::numeric_limits<double>::max());
+		auto next = std::uniform_int_distribution<size_t>(0, x_list.size() - 1)(gen);
+
+		while (values.size() < num_clusters)
+		{
+			auto value_row = make_value_row(x_list[next].size());
+			for (size_t d = 0; d < value_row.size(); ++d)
+				value_row[d] = data_to_value(x_list[next][d]);
+
+			values.push_back(std::move(value_row));
+
+			double total = 0;
+			for (size_t i = 0; i < x_list.size(); ++i)
+			{
+				min_distances[i] = std::min(min_distances[i], value_distance(x_list[i], values.back()));
+				total += min_distances[i];
+			}
+
+			if (!(total > 0)) // every row is already a centroid
+			{
+				next = std::uniform_int_distribution<size_t>(0, x_list.size() - 1)(gen);
+				continue;
+			}
+
+			auto target = std::uniform_real_distribution<double>(0, total)(gen);
+			for (next = 0; next + 1 < x_list.size(); ++next)
+			{
+				target -= min_distances[next];
+				if (target < 0 && min_distances[next] > 0)
+					break;
+			}
+		}
+
+		return values;
+	}
+
+
+	value_row_list_t initial_values(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
 	{
-		return *std::max_element(list.begin(), list.end());
+		if constexpr (CLUSTER_SEEDING == seeding_t::kmeans_pp)
+			return kmeans_pp_values(x_list, num_clusters, seed);
+
+		return random_values(x_list, num_clusters, seed);
 	}
 
-	cluster_result_t cluster_once(data_row_list_t const& x_list, size_t num_clusters)
+
+	// Elkan's algorithm, gives the same clusters as Lloyd's with far fewer distance calculations
+	// keeps an upper bound for each row and a lower bound for each row and centroid
+	cluster_result_t cluster_once_elkan(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
 	{
-		auto centroids = random_values(x_list, num_clusters);
-		auto result = assign_clusters(x_list, centroids, num_clusters);
+		// bounds need a distance that obeys the triangle inequality
+		const auto metric = [](data_row_t const& data, value_row_t const& centroid) { return std::sqrt(value_distance(data, centroid)); };
+		const auto centroid_metric = [](value_row_t const& lhs, value_row_t const& rhs) { return std::sqrt(list_distance(lhs, rhs)); };
+
+		const auto num_data = x_list.size();
+		auto centroids = initial_values(x_list, num_clusters, seed);
+
+		index_list_t x_clusters(num_data);
+		std::vector<double> upper(num_data);                // distance of each row from its centroid is at most this
+		std::vector<double> lower(num_data * num_clusters); // distance of each row from each centroid is at least this
+
+		for (size_t i = 0; i < num_data; ++i)
+		{
+			auto const row_lower = lower.data() + i * num_clusters;
+
+			size_t best = 0;
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				row_lower[k] = metric(x_list[i], centroids[k]);
+				if (row_lower[k] < row_lower[best])
+					best = k;
+			}
+
+			x_clusters[i] = best;
+			upper[i] = row_lower[best];
+		}
+
+		std::vector<double> shift(num_clusters);
+		std::vector<double> pair_distances(num_clusters * num_clusters);
+		std::vector<double> half_nearest(num_clusters);
+		auto next = centroids;
+
+		for (size_t iteration = 0; iteration < CLUSTER_ITERATIONS; ++iteration)
+		{
+			// an empty cluster keeps its centroid, as in lloyd
+			update_centroids(x_list, x_clusters, centroids, next);
+
+			bool moved = false;
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				shift[k] = centroid_metric(next[k], centroids[k]);
+				moved = moved || shift[k] > 0;
+			}
+
+			if (!moved)
+				break;
+
+			std::swap(centroids, next);
+
+			// half the distance of each centroid to its nearest other centroid
+			for (size_t a = 0; a < num_clusters; ++a)
+			{
+				half_nearest[a] = std::numeric_limits<double>::max();
+				for (size_t b = 0; b < num_clusters; ++b)
+				{
+					pair_distances[a * num_clusters + b] = a == b ? 0 : centroid_metric(centroids[a], centroids[b]);
+					if (a != b)
+						half_nearest[a] = std::min(half_nearest[a], 0.5 * pair_distances[a * num_clusters + b]);
+				}
+			}
+
+			size_t changed = 0;
+
+			for (size_t i = 0; i < num_data; ++i)
+			{
+				auto const row_lower = lower.data() + i * num_clusters;
+
+				// bounds follow the centroids
+				for (size_t k = 0; k < num_clusters; ++k)
+					row_lower[k] = std::max(row_lower[k] - shift[k], 0.0);
+
+				auto c = x_clusters[i];
+				auto u = upper[i] + shift[c];
+
+				if (u > half_nearest[c])
+				{
+					bool is_exact = false;
+
+					for (size_t k = 0; k < num_clusters; ++k)
+					{
+						if (k == c || u <= row_lower[k] || u <= 0.5 * pair_distances[c * num_clusters + k])
+							continue;
+
+						if (!is_exact)
+						{
+							u = metric(x_list[i], centroids[c]);
+							row_lower[c] = u;
+							is_exact = true;
+
+							if (u <= row_lower[k] || u <= 0.5 * pair_distances[c * num_clusters + k])
+								continue;
+						}
+
+						const auto dist = metric(x_list[i], centroids[k]);
+						row_lower[k] = dist;
+
+						if (dist < u)
+						{
+							u = dist;
+							c = k;
+						}
+					}
+				}
+
+				upper[i] = u;
+
+				if (c != x_clusters[i])
+				{
+					x_clusters[i] = c;
+					++changed;
+				}
+			}
+
+			if (!changed)
+				break;
+		}
+
+		double total_distance = 0;
+		for (size_t i = 0; i < num_data; ++i)
+			total_distance += value_distance(x_list[i], centroids[x_clusters[i]]);
+
+		cluster_result_t result = { std::move(x_clusters), std::move(centroids), total_distance / num_data };
 		relabel_clusters(result, num_clusters);
 
+		return result;
+	}
+
+
+	// Lloyd's algorithm from the given centroids
+	cluster_result_t iterate_clusters(data_row_list_t const& x_list, value_row_list_t centroids)
+	{
+		const auto num_clusters = centroids.size();
+		auto result = assign_clusters(x_list, centroids);
+
+		auto centroids_try = result.centroids;
+		index_list_t x_clusters_try(x_list.size());
+
+		// stops when no row changes cluster or no centroid moves more than CLUSTER_TOLERANCE
 		for (size_t i = 0; i < CLUSTER_ITERATIONS; ++i)
 		{
-			centroids = calc_centroids(x_list, result.x_clusters, num_clusters);
-			auto res_try = assign_clusters(x_list, centroids, num_clusters);
+			if (update_centroids(x_list, result.x_clusters, result.centroids, centroids_try) <= CLUSTER_TOLERANCE)
+				break;
 
-			if (max_value(res_try.x_clusters) < num_clusters - 1)
-				continue;
+			auto assignment = assign_labels(x_list, centroids_try, result.x_clusters, x_clusters_try);
+
+			if (assignment.empty) // the same centroids would be found again
+				break;
 
-			auto res_old = std::move(result);
-			result = std::move(res_try);
-			relabel_clusters(result, num_clusters);
+			std::swap(result.x_clusters, x_clusters_try);
+			std::swap(result.centroids, centroids_try);
+			result.average_distance = assignment.total_distance / x_list.size();
 
-			if (list_distance(res_old.x_clusters, result.x_clusters) == 0)
-				return result;
+			if (!assignment.changed)
+				break;
 		}
 
+		relabel_clusters(result, num_clusters);
+
 		return result;
 	}
 
 
+	cluster_result_t cluster_once(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
+	{
+		if constexpr (CLUSTER_ALGORITHM == algorithm_t::elkan)
+			return cluster_once_elkan(x_list, num_clusters, seed);
+
+		return iterate_clusters(x_list, initial_values(x_list, num_clusters, seed));
+	}
+
+
+	// centroids of a result plus one more, at the row furthest from its centroid in the cluster with the largest total distance
+	value_row_list_t split_worst_cluster(data_row_list_t const& x_list, cluster_result_t const& result)
+	{
+		const auto num_clusters = result.centroids.size();
+
+		std::vector<double> totals(num_clusters, 0);
+		std::vector<double> distances(x_list.size());
+
+		for (size_t i = 0; i < x_list.size(); ++i)
+		{
+			distances[i] = value_distance(x_list[i], result.centroids[result.x_clusters[i]]);
+			totals[result.x_clusters[i]] += distances[i];
+		}
+
+		const auto worst = static_cast<size_t>(std::max_element(totals.begin(), totals.end()) - totals.begin());
+
+		size_t furthest = 0;
+		double furthest_distance = -1;
+		for (size_t i = 0; i < x_list.size(); ++i)
+		{
+			if (result.x_clusters[i] == worst && distances[i] > furthest_distance)
+			{
+				furthest_distance = distances[i];
+				furthest = i;
+			}
+		}
+
+		auto centroids = result.centroids;
+		auto value_row = make_value_row(x_list[furthest].size());
+		for (size_t d = 0; d < value_row.size(); ++d)
+			value_row[d] = data_to_value(x_list[furthest][d]);
+
+		centroids.push_back(std::move(value_row));
+
+		return centroids;
+	}
+
+
+	//======= K-MODES =======================
+
+	// rows packed 8 chars to a word, bytes past the end of a row are zero in every row so they always match
+	typedef struct PackedRows {
+		std::vector<uint64_t> words;
+		size_t stride; // words in each row
+
+	} packed_rows_t;
+
+
+	void pack_row(data_row_t const& row, size_t data_size, uint64_t* words)
+	{
+		for (size_t i = 0; i < std::min(row.size(), data_size); ++i)
+			words[i / 8] |= uint64_t(static_cast<uint8_t>(row[i])) << (8 * (i % 8));
+	}
+
+
+	packed_rows_t pack_rows(data_row_list_t const& x_list, size_t data_size)
+	{
+		const auto stride = (data_size + 7) / 8;
+		packed_rows_t res = { std::vector<uint64_t>(x_list.size() * stride, 0), stride };
+
+		for (size_t i = 0; i < x_list.size(); ++i)
+			pack_row(x_list[i], data_size, res.words.data() + i * stride);
+
+		return res;
+	}
+
+
+	// number of chars that differ, 8 chars are compared at a time
+	size_t hamming_distance(uint64_t const* lhs, uint64_t const* rhs, size_t stride)
+	{
+		constexpr uint64_t low_bits = 0x7F7F7F7F7F7F7F7Full;
+
+		size_t sum = 0;
+		for (size_t w = 0; w < stride; ++w)
+		{
+			const auto diff = lhs[w] ^ rhs[w];
+			const auto nonzero = (((diff & low_bits) + low_bits) | diff) & ~low_bits; // top bit set for each byte that differs
+
+			sum += std::bitset<64>(nonzero).count();
+		}
+
+		return sum;
+	}
+
+
+	// k-modes, each char is a category that only matches itself
+	// centroids are the most common char at each position of the rows in a cluster
+	cluster_result_t cluster_once_modes(data_row_list_t const& x_list, size_t num_clusters, uint64_t seed)
+	{
+		constexpr size_t num_chars = 256;
+
+		const auto num_data = x_list.size();
+		const auto data_size = x_list[0].size();
+
+		const auto rows = pack_rows(x_list, data_size);
+		auto mode_rows = to_data_row_list(random_values(x_list, num_clusters, seed));
+		auto modes = pack_rows(mode_rows, data_size);
+
+		index_list_t x_clusters(num_data, num_clusters);
+		std::vector<uint32_t> frequencies(num_clusters * data_size * num_chars);
+		size_t total_distance = 0;
+
+		for (size_t iteration = 0; ; ++iteration)
+		{
+			size_t changed = 0;
+			total_distance = 0;
+
+			for (size_t i = 0; i < num_data; ++i)
+			{
+				auto const row = rows.words.data() + i * rows.stride;
+
+				size_t best = 0;
+				size_t best_distance = std::numeric_limits<size_t>::max();
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					const auto dist = hamming_distance(row, modes.words.data() + k * modes.stride, rows.stride);
+					if (dist < best_distance)
+					{
+						best_distance = dist;
+						best = k;
+					}
+				}
+
+				changed += x_clusters[i] != best;
+				x_clusters[i] = best;
+				total_distance += best_distance;
+			}
+
+			if (!changed || iteration == CLUSTER_ITERATIONS)
+				break;
+
+			// most common char at each position, ties and empty clusters keep the current mode
+			std::fill(frequencies.begin(), frequencies.end(), 0);
+			for (size_t i = 0; i < num_data; ++i)
+			{
+				auto const table = frequencies.data() + x_clusters[i] * data_size * num_chars;
+				for (size_t d = 0; d < std::min(x_list[i].size(), data_size); ++d)
+					++table[d * num_chars + static_cast<uint8_t>(x_list[i][d])];
+			}
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				for (size_t d = 0; d < data_size; ++d)
+				{
+					auto const table = frequencies.data() + (k * data_size + d) * num_chars;
+
+					auto mode = static_cast<uint8_t>(mode_rows[k][d]);
+					for (size_t c = 0; c < num_chars; ++c)
+					{
+						if (table[c] > table[mode])
+							mode = static_cast<uint8_t>(c);
+					}
+
+					mode_rows[k][d] = static_cast<char>(mode);
+				}
+			}
+
+			modes = pack_rows(mode_rows, data_size);
+		}
+
+		// labels are not renumbered so each centroid stays with its cluster
+		cluster_result_t result = { std::move(x_clusters), to_value_row_list(mode_rows), double(total_distance) / num_data };
+
+		return result;
+	}
+
+
+	// calls task(i) for each i in [0, num_tasks) on CLUSTER_THREADS threads, including the calling thread
+	template<typename F>
+	void run_parallel(size_t num_tasks, F const& task)
+	{
+		std::atomic<size_t> next_task = 0;
+
+		const auto run_tasks = [&]()
+		{
+			for (size_t i = next_task++; i < num_tasks; i = next_task++)
+				task(i);
+		};
+
+		size_t num_threads = CLUSTER_THREADS ? CLUSTER_THREADS : std::thread::hardware_concurrency();
+		num_threads = std::max(std::min(num_threads, num_tasks), size_t(1));
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < num_threads; ++i)
+			threads.emplace_back(run_tasks);
+
+		run_tasks();
+
+		for (auto& t : threads)
+			t.join();
+	}
+
+
 	// returns the result with the smallest distance
-	cluster_result_t cluster_min_distance(data_row_list_t const& x_list, size_t num_clusters)
+	// attempts run on CLUSTER_THREADS threads, each seeded from the master seed
+	// ties go to the earliest attempt so the result does not depend on the number of threads
+	template<typename F>
+	cluster_result_t min_distance_attempts(data_row_list_t const& x_list, size_t num_clusters, F const& cluster_once)
 	{
-		auto result = cluster_once(x_list, num_clusters);
-		auto min = result;
+		constexpr size_t num_attempts = CLUSTER_ATTEMPTS + 1;
+		const auto seed = master_seed();
+
+		cluster_result_t min;
+		size_t min_attempt = num_attempts;
+		std::mutex min_mutex;
 
-		for (size_t i = 0; i < CLUSTER_ATTEMPTS; ++i)
+		run_parallel(num_attempts, [&](size_t attempt)
 		{
-			result = cluster_once(x_list, num_clusters);
-			if (result.average_distance < min.average_distance)
+			auto result = cluster_once(x_list, num_clusters, attempt_seed(seed, attempt));
+
+			std::lock_guard<std::mutex> lock(min_mutex);
+
+			const bool is_min = min_attempt == num_attempts
+				|| result.average_distance < min.average_distance
+				|| (result.average_distance == min.average_distance && attempt < min_attempt);
+
+			if (is_min)
+			{
 				min = std::move(result);
-		}
+				min_attempt = attempt;
+			}
+		});
 
 		return min;
 	}
 
 
+	cluster_result_t cluster_min_distance(data_row_list_t const& x_list, size_t num_clusters)
+	{
+		return min_distance_attempts(x_list, num_clusters, cluster_once);
+	}
+
+
+	cluster_result_t cluster_modes(data_row_list_t const& x_list, size_t num_clusters)
+	{
+		return min_distance_attempts(x_list, num_clusters, cluster_once_modes);
+	}
+
+
+	// fingerprint of cluster labels, equal labels give equal hashes
+	uint64_t hash_labels(index_list_t const& x_clusters)
+	{
+		uint64_t hash = x_clusters.size();
+		for (auto const c : x_clusters)
+			hash = mix_seed(hash ^ c);
+
+		return hash;
+	}
+
+
 	// returns the most popular result
-	// stops when the same result has been found for more than half of the attempts
+	// results are told apart by a hash of their labels, which relabel_clusters has put in order of first appearance
+	// only one copy of each distinct result is kept
+	// stops as soon as no other result can catch up with the most popular one,
+	// which includes the most popular one having been found for more than half of the attempts
 	cluster_result_t cluster_max_count(data_row_list_t const& x_list, size_t num_clusters)
 	{
-		std::vector<cluster_count_t> counts;
-		counts.reserve(CLUSTER_ATTEMPTS);
+		constexpr size_t num_attempts = CLUSTER_ATTEMPTS + 1;
+		const auto seed = master_seed();
 
-		auto result = cluster_once(x_list, num_clusters);
-		counts.push_back({ std::move(result), 1 });
+		std::vector<cluster_count_t> counts;
+		size_t best = 0; // earliest result with the highest count
 
-		for (size_t i = 0; i < CLUSTER_ATTEMPTS; ++i)
+		for (size_t attempt = 0; attempt < num_attempts; ++attempt)
 		{
-			result = cluster_once(x_list, num_clusters);
+			auto result = cluster_once(x_list, num_clusters, attempt_seed(seed, attempt));
+			const auto hash = hash_labels(result.x_clusters);
+
+			const auto same = [&](cluster_count_t const& c) { return c.hash == hash && c.result.x_clusters == result.x_clusters; };
 
-			bool add_clusters = true;
-			for (auto& c : counts)
+			auto found = std::find_if(counts.begin(), counts.end(), same);
+			if (found == counts.end())
 			{
-				if (list_distance(result.x_clusters, c.result.x_clusters) != 0)
-					continue;
+				counts.push_back({ std::move(result), 0, hash });
+				found = counts.end() - 1;
+			}
 
-				++c.count;
-				if (c.count > CLUSTER_ATTEMPTS / 2)
-					return c.result;
+			++found->count;
 
-				add_clusters = false;
-				break;
+			unsigned runner_up = 0;
+			for (size_t c = 0; c < counts.size(); ++c)
+			{
+				if (counts[c].count > counts[best].count)
+					best = c;
 			}
 
-			if (add_clusters)
+			for (size_t c = 0; c < counts.size(); ++c)
 			{
-				counts.push_back({ std::move(result), 1 });
+				if (c != best)
+					runner_up = std::max(runner_up, counts[c].count);
 			}
+
+			const auto remaining = num_attempts - attempt - 1;
+			if (counts[best].count > runner_up + remaining)
+				break;
 		}
 
+		return std::move(counts[best].result);
+	}
+
 
-		auto constexpr comp = [](cluster_count_t const& lhs, cluster_count_t const& rhs) { return lhs.count < rhs.count; };
-		auto const best = *std::max_element(counts.begin(), counts.end(), comp);
+	// index of the earliest result whose labels were found by the most attempts, as cluster_max_count chooses
+	size_t most_common(std::vector<cluster_result_t> const& results)
+	{
+		std::vector<uint64_t> hashes(results.size());
+		for (size_t i = 0; i < results.size(); ++i)
+			hashes[i] = hash_labels(results[i].x_clusters);
+
+		size_t best = 0;
+		unsigned best_count = 0;
 
-		return best.result;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			unsigned count = 0;
+			for (size_t j = 0; j < results.size(); ++j)
+			{
+				if (hashes[j] == hashes[i] && results[j].x_clusters == results[i].x_clusters)
+					++count;
+			}
+
+			if (count > best_count)
+			{
+				best = i;
+				best_count = count;
+			}
+		}
+
+		return best;
 	}
 
 
-	// keeps increasing the number of clusters until the incremental improvement is small enough
-	cluster_result_t cluster_unknown(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters)
+	// every attempt clusters with min_clusters, then each further number of clusters starts from the attempt's previous result
+	// with its worst cluster split in two; attempts run on CLUSTER_THREADS threads
+	// the most common result of the attempts is kept for each row, the same choice as cluster_max_count
+	// stops early once is_done(table) is true
+	template<typename F>
+	sweep_table_t sweep(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters, F const& is_done)
 	{
-		auto const cluster_algorithm = cluster_max_count;
+		constexpr size_t num_attempts = CLUSTER_ATTEMPTS + 1;
+		const auto seed = master_seed();
 
-		// cannot compare, 3 will allways be better than 2
-		if (max_clusters <= 3)
-			return cluster_algorithm(x_list, max_clusters);
+		std::vector<cluster_result_t> attempts(num_attempts);
+		sweep_table_t table;
 
-		constexpr double improve_tolerance = 0.1;
-		auto last = cluster_algorithm(x_list, min_clusters - 2); std::cout << 2 << " : " << last.average_distance << "\n";
-		auto next = cluster_algorithm(x_list, min_clusters - 1); std::cout << 3 << " : " << next.average_distance << "\n";
+		for (size_t k = std::max(min_clusters, size_t(1)); k <= max_clusters; ++k)
+		{
+			const auto start = std::chrono::steady_clock::now();
 
-		auto last_improvement = last.average_distance - next.average_distance;
+			run_parallel(num_attempts, [&](size_t attempt)
+			{
+				if (table.empty())
+					attempts[attempt] = cluster_once(x_list, k, attempt_seed(seed, attempt));
+				else
+					attempts[attempt] = iterate_clusters(x_list, split_worst_cluster(x_list, attempts[attempt]));
+			});
 
-		for (size_t k = min_clusters; k <= max_clusters; ++k)
-		{
-			last = std::move(next);
-			next = cluster_algorithm(x_list, k); std::cout << k << " : " << next.average_distance << "\n";
-			auto improvement = last.average_distance - next.average_distance;
+			const auto best = most_common(attempts);
 
-			if (improvement < improve_tolerance * next.average_distance)
-				return last;
+			const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+			table.push_back({ k, attempts[best].average_distance, seconds.count(), attempts[best] });
 
-			last_improvement = improvement;
+			if (is_done(table))
+				break;
 		}
 
-		return next;
+		return table;
 	}
 
 
-	// for trying to find the best number of clusters
-	void find_clusters(data_row_list_t const& x_list, size_t max_clusters)
+	sweep_table_t sweep_clusters(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters)
 	{
-		auto const cluster_algorithm = cluster_max_count;
-		const size_t min_clusters = 2;
-		Stopwatch stop_watch;
-		double last_time = 0;
-		double last_dist = 0;
+		return sweep(x_list, min_clusters, max_clusters, [](sweep_table_t const&) { return false; });
+	}
+
 
-		for (size_t k = min_clusters; k <= max_clusters; ++k)
+	// keeps increasing the number of clusters until the incremental improvement is small enough
+	cluster_result_t cluster_unknown(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters)
+	{
+		// cannot compare, 3 will allways be better than 2
+		if (max_clusters <= 3)
+			return cluster_max_count(x_list, max_clusters);
+
+		constexpr double improve_tolerance = 0.1;
+
+		const auto is_done = [&](sweep_table_t const& table)
 		{
-			stop_watch.start();
+			const auto size = table.size();
+			if (size < 2 || table.back().num_clusters < min_clusters)
+				return false;
 
-			auto result = cluster_algorithm(x_list, k);
-			auto time = stop_watch.get_time_sec();
-			auto dist = result.average_distance;
+			const auto improvement = table[size - 2].average_distance - table[size - 1].average_distance;
 
-			std::cout << k << " | "
-				<< dist << " (" << (1 - dist / last_dist) << ")" << " | "
-				<< time << "(" << (time - last_time) << ")" << "\n";
+			return improvement < improve_tolerance * table[size - 1].average_distance;
+		};
 
-			last_time = time;
-			last_dist = dist;
-		}
+		auto table = sweep(x_list, min_clusters > 2 ? min_clusters - 2 : 1, max_clusters, is_done);
 
+		if (is_done(table))
+			return std::move(table[table.size() - 2].result);
 
+		return std::move(table.back().result);
+	}
+
+
+	// for trying to find the best number of clusters
+	sweep_table_t find_clusters(data_row_list_t const& x_list, size_t max_clusters)
+	{
+		return sweep_clusters(x_list, 2, max_clusters);
 	}
 
 
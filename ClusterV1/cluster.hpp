@@ -26,15 +26,49 @@ namespace cluster
 	} cluster_result_t;
 
 
+	typedef struct SweepRow {
+		size_t num_clusters;
+		value_t average_distance; // of the best attempt
+		double seconds;           // time taken for this number of clusters
+		cluster_result_t result;  // most common result of the attempts
+
+	} sweep_row_t;
+
+	using sweep_table_t = std::vector<sweep_row_t>;
+
+
+	enum class algorithm_t
+	{
+		lloyd, // compares every row with every centroid in each iteration
+		elkan  // keeps a lower bound for each row and centroid to skip most distance calculations
+	};
+
+
+	enum class seeding_t
+	{
+		random,   // random rows of data
+		kmeans_pp // k-means++, each centroid is chosen far from the ones before it
+	};
+
+
 	//======= CLUSTER ALGORITHMS =========================
 
 	// returns the result with the smallest distance
 	cluster_result_t cluster_min_distance(data_row_list_t const& x_list, size_t num_clusters);
 
 	// returns the most popular result
-	// stops when the same result has been found for more than half of the attempts
+	// stops as soon as no other result can be found more often, e.g. once the same result has been found for more than half of the attempts
 	cluster_result_t cluster_max_count(data_row_list_t const& x_list, size_t num_clusters);
 
+	// k-modes for rows of categorical chars, distance is the number of positions that differ
+	// centroids hold the most common char at each position
+	cluster_result_t cluster_modes(data_row_list_t const& x_list, size_t num_clusters);
+
+	// clusters with each number of clusters in [min_clusters, max_clusters]
+	// each number of clusters starts from the result of the one before with its worst cluster split, attempts run in parallel
+	// the most common result of the attempts is kept for each number of clusters, as cluster_max_count
+	sweep_table_t sweep_clusters(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters);
+
 	// keeps increasing the number of clusters until the incremental improvement is small enough
 	cluster_result_t cluster_unknown(data_row_list_t const& x_list, size_t min_clusters, size_t max_clusters);
 
@@ -59,6 +93,6 @@ namespace cluster
 
 	//======= TESTING ======================
 
-	// for trying to find the best number of clusters
-	void find_clusters(data_row_list_t const& x_list, size_t max_clusters);
+	// for trying to find the best number of clusters, sweeps from 2 to max_clusters
+	sweep_table_t find_clusters(data_row_list_t const& x_list, size_t max_clusters);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "cluster.hpp"
 
 #include <cmath>
+#include <cstdint>
 
 namespace cluster
 {
@@ -9,6 +10,18 @@ namespace cluster
 
 	constexpr size_t CLUSTER_ATTEMPTS = 30;
 	constexpr size_t CLUSTER_ITERATIONS = 30;
+	constexpr double CLUSTER_TOLERANCE = 0; // stops iterating once no centroid value moves more than this
+
+	constexpr size_t CLUSTER_THREADS = 1; // threads for running attempts in parallel, 0 uses all hardware threads
+	constexpr uint64_t CLUSTER_SEED = 0;  // makes results repeatable, 0 seeds from std::random_device
+
+	constexpr algorithm_t CLUSTER_ALGORITHM = algorithm_t::lloyd; // algorithm_t::elkan gives the same clusters with fewer distance calculations
+	constexpr seeding_t CLUSTER_SEEDING = seeding_t::random;      // seeding_t::kmeans_pp needs fewer attempts and iterations
+
+	// assigns rows by comparing bytes with centroids rounded to chars using SSE2 / AVX2
+	// only valid while data_to_value is a plain cast of each char
+	// approximate, the rounding can change assignments and the distance may not fall every iteration, so results differ from elkan
+	constexpr bool CLUSTER_BYTE_DISTANCE = false;
 
 
 	//======= DATA FUNCTIONS =======================
@@ -1,14 +1,15 @@
 #pragma once
 #include <chrono>
 
+// elapsed time of a measurement, steady_clock so it is not thrown off by changes to the system time
 class Stopwatch
 {
 private:
-	std::chrono::system_clock::time_point start_;
-	std::chrono::system_clock::time_point end_;
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point end_;
 	bool is_on_ = false;
 
-	std::chrono::system_clock::time_point now() { return std::chrono::system_clock::now(); }
+	std::chrono::steady_clock::time_point now() { return std::chrono::steady_clock::now(); }
 
 public:
 	Stopwatch()
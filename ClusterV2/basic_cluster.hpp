@@ -0,0 +1,323 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+#include "cluster_elkan.hpp"
+#include "cluster_hamerly.hpp"
+#include "cluster_mini_batch.hpp"
+#include "cluster_approximate.hpp"
+#include "cluster_blocked.hpp"
+#include "cluster_workspace.hpp"
+
+#include <memory>
+#include <cmath>
+
+namespace cluster
+{
+	//======= DISTANCE POLICIES =======================
+
+	// a distance policy is called with a data row, a centroid row and the number of values in each
+	// rows are either std::vector or pointers into a matrix
+	// double operator()(Row const& data, Centroid const& centroid, size_t size) const;
+
+
+	struct SquaredEuclidean
+	{
+		metric_t metric() const { return metric_t::squared_euclidean; }
+
+		bool is_metric() const { return true; }
+
+		double to_metric(double distance) const { return std::sqrt(distance); }
+
+		template<typename R, typename C>
+		double operator()(R const& data, C const& centroid, size_t size) const
+		{
+			double sum = 0;
+			for (size_t i = 0; i < size; ++i)
+			{
+				const double diff = data[i] - centroid[i];
+				sum += diff * diff;
+			}
+
+			return sum;
+		}
+	};
+
+
+	struct Manhattan
+	{
+		metric_t metric() const { return metric_t::manhattan; }
+
+		bool is_metric() const { return true; }
+
+		double to_metric(double distance) const { return distance; }
+
+		template<typename R, typename C>
+		double operator()(R const& data, C const& centroid, size_t size) const
+		{
+			double sum = 0;
+			for (size_t i = 0; i < size; ++i)
+				sum += std::abs(data[i] - centroid[i]);
+
+			return sum;
+		}
+	};
+
+
+	//======= CONVERSION POLICIES =======================
+
+	// how a data value is interpreted as if it were a centroid value
+	// value_t operator()(data_t data) const;
+
+
+	struct Identity
+	{
+		value_t operator()(data_t data) const { return data; }
+	};
+
+
+	//======= CLASS DEFINITION =======================
+
+	// clustering with the distance and conversion known at compile time
+	// when Dimension is given every row must have exactly Dimension values,
+	// the loops over the values of a row then have a fixed length and can be unrolled
+	template<typename Distance = SquaredEuclidean, typename ToValue = Identity, size_t Dimension = dynamic_dimension>
+	class BasicCluster
+	{
+	protected:
+
+		Distance m_distance;
+		ToValue m_to_value;
+
+		std::shared_ptr<ThreadPool> m_pool;
+		uint64_t m_seed = 0;
+		bool m_use_seed = false;
+		parallel_t m_parallel = parallel_t::attempts;
+		algorithm_t m_algorithm = algorithm_t::lloyd;
+		seeding_t m_seeding = seeding_t::random;
+		selection_t m_selection = selection_t::min_distance;
+		mini_batch_t m_mini_batch;
+		approximate_t m_approximate;
+		size_t m_attempts = CLUSTER_ATTEMPTS + 1;
+		std::shared_ptr<ClusterObserver> m_observer;
+
+		uint64_t master_seed() const;
+
+		ThreadPool& attempt_pool() const;
+
+		template<typename Result, typename L, typename D>
+		Result& cluster(L const& x_list, size_t num_clusters, D const& distance, algorithm_t algorithm, ClusterWorkspace<Result>& workspace) const;
+
+		template<typename Result, typename L>
+		Result& cluster(L const& x_list, size_t num_clusters, ClusterWorkspace<Result>& workspace) const;
+
+	public:
+
+		BasicCluster(Distance const& distance = Distance(), ToValue const& to_value = ToValue())
+			: m_distance(distance), m_to_value(to_value)
+		{
+			m_pool = std::make_shared<ThreadPool>(1);
+		}
+
+		// number of threads used to run clustering attempts in parallel
+		// 0 uses all hardware threads, 1 (default) runs on the calling thread
+		void set_threads(size_t num_threads) { m_pool = std::make_shared<ThreadPool>(num_threads); }
+
+		// how the work is split over the threads
+		// parallel_t::data suits a large data set with few attempts
+		void set_parallel(parallel_t mode) { m_parallel = mode; }
+
+		// algorithm_t::elkan and algorithm_t::hamerly give the same clusters with far fewer distance calculations
+		// algorithm_t::automatic picks one of them from the size of the data and the number of clusters
+		// they need a distance that obeys the triangle inequality (squared euclidean or manhattan),
+		// other distances use algorithm_t::lloyd
+		// algorithm_t::mini_batch works from random batches of data, see set_mini_batch
+		// algorithm_t::approximate is for very many clusters, see set_approximate
+		void set_algorithm(algorithm_t algorithm) { m_algorithm = algorithm; }
+
+		// batch size and stopping rule of algorithm_t::mini_batch
+		void set_mini_batch(mini_batch_t const& options) { m_mini_batch = options; }
+
+		// how closely algorithm_t::approximate searches, more probes give results closer to lloyd
+		// only contiguous rows (data_view_t) are clustered approximately, nested vectors use algorithm_t::lloyd
+		void set_approximate(approximate_t const& options) { m_approximate = options; }
+
+		// how the starting centroids of each attempt are chosen
+		// seeding_t::kmeans_pp and seeding_t::kmeans_parallel need far fewer attempts and iterations than random rows
+		void set_seeding(seeding_t seeding) { m_seeding = seeding; }
+
+		// number of clustering attempts
+		void set_attempts(size_t num_attempts) { m_attempts = std::max(num_attempts, size_t(1)); }
+
+		// which attempt is kept, the one with the smallest average distance (default) or the most common result
+		// selection_t::max_count runs the attempts one after the other, set_parallel(parallel_t::data) still splits each iteration
+		void set_selection(selection_t selection) { m_selection = selection; }
+
+		// makes results repeatable, each attempt gets its own random stream derived from the seed
+		// without a seed every call to cluster_data uses a different random seed
+		void set_seed(uint64_t seed) { m_seed = seed; m_use_seed = true; }
+
+		// receives an event after every iteration and every attempt, nullptr (default) stops the events
+		// attempts running in parallel report from their own threads
+		void set_observer(std::shared_ptr<ClusterObserver> observer) { m_observer = std::move(observer); }
+
+		// determines clusters given the data and the number of clusters
+		cluster_result_t cluster_data(data_row_list_t const& x_list, size_t num_clusters) const;
+
+		// determines clusters given contiguous rows of data
+		// the data is not copied, x_list can view memory owned by the caller
+		matrix_result_t cluster_data(data_view_t const& x_list, size_t num_clusters) const;
+
+		// same as cluster_data with the scratch buffers and the result kept in the workspace
+		// reusing the workspace for data of the same size avoids allocating, the result is valid until it is used again
+		cluster_result_t const& cluster_data(data_row_list_t const& x_list, size_t num_clusters, cluster_workspace_t& workspace) const;
+
+		matrix_result_t const& cluster_data(data_view_t const& x_list, size_t num_clusters, matrix_workspace_t& workspace) const;
+
+		// the distance policy, e.g. for building a CentroidIndex that measures distance the same way
+		Distance const& distance() const { return m_distance; }
+
+		// The index of the closest centroid for the given data row
+		size_t find_centroid(data_row_t const& data, value_row_list_t const& centroids) const;
+
+		// The index of the closest centroid for a row of centroids.dimension() values
+		size_t find_centroid(data_t const* data, value_view_t const& centroids) const;
+	};
+
+
+	//======= CLASS METHODS ==============================
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	uint64_t BasicCluster<Distance, ToValue, Dimension>::master_seed() const
+	{
+		if (m_use_seed)
+			return m_seed;
+
+		std::random_device rd;
+
+		return (static_cast<uint64_t>(rd()) << 32) | rd();
+	}
+
+
+	// threads available for running attempts
+	// when the data is split over the threads the attempts run one after the other
+	template<typename Distance, typename ToValue, size_t Dimension>
+	ThreadPool& BasicCluster<Distance, ToValue, Dimension>::attempt_pool() const
+	{
+		static ThreadPool serial(1);
+
+		return m_parallel == parallel_t::attempts ? *m_pool : serial;
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	template<typename Result, typename L, typename D>
+	Result& BasicCluster<Distance, ToValue, Dimension>::cluster(L const& x_list, size_t num_clusters, D const& distance, algorithm_t algorithm, ClusterWorkspace<Result>& workspace) const
+	{
+		auto const cluster_once = [&](L const& x_list, size_t num_clusters, size_t index, uint64_t seed, algorithms::AttemptWorkspace<Result>& attempt)
+		{
+			const algorithms::AttemptProgress progress(m_observer.get(), index);
+
+			if (algorithm == algorithm_t::elkan)
+				attempt.result = algorithms::cluster_once_elkan<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, *m_pool, progress);
+			else if (algorithm == algorithm_t::mini_batch)
+				attempt.result = algorithms::cluster_once_mini_batch<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, m_mini_batch, *m_pool, progress);
+			else if (algorithm == algorithm_t::hamerly)
+				attempt.result = algorithms::cluster_once_hamerly<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, *m_pool, progress);
+			else if constexpr (std::is_same_v<L, data_view_t>)
+			{
+				if (algorithm == algorithm_t::approximate)
+					algorithms::cluster_once_approximate<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, m_approximate, *m_pool, attempt, progress);
+				else
+					algorithms::cluster_once<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, *m_pool, attempt, progress);
+			}
+			else
+				algorithms::cluster_once<Result, Dimension>(x_list, num_clusters, distance, m_to_value, seed, m_seeding, *m_pool, attempt, progress);
+		};
+
+		if (m_selection == selection_t::max_count)
+			return algorithms::cluster_max_count(x_list, num_clusters, cluster_once, master_seed(), m_attempts, workspace);
+
+		return algorithms::cluster_min_distance(x_list, num_clusters, cluster_once, attempt_pool(), master_seed(), m_attempts, workspace);
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	template<typename Result, typename L>
+	Result& BasicCluster<Distance, ToValue, Dimension>::cluster(L const& x_list, size_t num_clusters, ClusterWorkspace<Result>& workspace) const
+	{
+		const auto data_size = algorithms::dimension<Dimension>(x_list);
+		auto algorithm = m_algorithm;
+
+		if (algorithm == algorithm_t::approximate && !std::is_same_v<L, data_view_t>)
+			algorithm = algorithm_t::lloyd;
+
+		if (algorithm != algorithm_t::mini_batch && algorithm != algorithm_t::approximate && !algorithms::is_metric(m_distance))
+			algorithm = algorithm_t::lloyd;
+
+		if (algorithm == algorithm_t::automatic)
+			algorithm = algorithms::select_algorithm(x_list.size(), num_clusters, data_size);
+
+		// wide contiguous rows are assigned in blocks, the row norms are shared by every attempt
+		if constexpr (std::is_same_v<L, data_view_t>)
+		{
+			if (algorithm == algorithm_t::lloyd && algorithms::use_blocked(m_distance, data_size))
+			{
+				const algorithms::BlockedDistance<Distance> blocked(m_distance, x_list, *m_pool, workspace.norms());
+
+				return cluster<Result>(x_list, num_clusters, blocked, algorithm, workspace);
+			}
+		}
+
+		return cluster<Result>(x_list, num_clusters, m_distance, algorithm, workspace);
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	cluster_result_t BasicCluster<Distance, ToValue, Dimension>::cluster_data(data_row_list_t const& x_list, size_t num_clusters) const
+	{
+		cluster_workspace_t workspace;
+
+		return std::move(cluster<cluster_result_t>(x_list, num_clusters, workspace));
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	matrix_result_t BasicCluster<Distance, ToValue, Dimension>::cluster_data(data_view_t const& x_list, size_t num_clusters) const
+	{
+		matrix_workspace_t workspace;
+
+		return std::move(cluster<matrix_result_t>(x_list, num_clusters, workspace));
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	cluster_result_t const& BasicCluster<Distance, ToValue, Dimension>::cluster_data(data_row_list_t const& x_list, size_t num_clusters, cluster_workspace_t& workspace) const
+	{
+		return cluster<cluster_result_t>(x_list, num_clusters, workspace);
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	matrix_result_t const& BasicCluster<Distance, ToValue, Dimension>::cluster_data(data_view_t const& x_list, size_t num_clusters, matrix_workspace_t& workspace) const
+	{
+		return cluster<matrix_result_t>(x_list, num_clusters, workspace);
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	size_t BasicCluster<Distance, ToValue, Dimension>::find_centroid(data_row_t const& data, value_row_list_t const& centroids) const
+	{
+		auto result = algorithms::closest<Dimension>(m_distance, data, centroids);
+
+		return result.index;
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	size_t BasicCluster<Distance, ToValue, Dimension>::find_centroid(data_t const* data, value_view_t const& centroids) const
+	{
+		auto result = algorithms::closest<Dimension>(m_distance, data, centroids);
+
+		return result.index;
+	}
+}
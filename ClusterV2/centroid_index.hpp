@@ -0,0 +1,328 @@
+#pragma once
+
+#include "basic_cluster.hpp"
+
+#include <numeric>
+#include <limits>
+
+// closest centroid searches against a fixed set of centroids, for serving a clustering result
+// small rows of squared euclidean or manhattan distance search a k-d tree over the centroids,
+// wide squared euclidean rows are answered in blocks with the blocked dot products,
+// anything else scans every centroid with the distance policy (vectorized for the built-in metrics)
+// an approximate index searches only the centroids of the closest groups of centroids, for very many centroids
+namespace cluster
+{
+	//======= CLASS DEFINITION =======================
+
+	template<typename Distance = SquaredEuclidean, size_t Dimension = dynamic_dimension>
+	class BasicCentroidIndex
+	{
+	private:
+
+		static constexpr size_t leaf_size = 8; // most centroids in a leaf of the tree
+
+		typedef struct Node
+		{
+			size_t split_dimension;
+			double split_value;
+			size_t children[2]; // below and above the split, 0 for a leaf
+			size_t begin;       // leaf centroids are rows [begin, end) of m_tree_centroids
+			size_t end;
+
+		} node_t;
+
+		Distance m_distance;
+		value_matrix_t m_centroids;
+
+		std::vector<node_t> m_nodes;        // empty when the tree is not used, m_nodes[0] is the root
+		value_matrix_t m_tree_centroids;    // centroids in leaf order
+		index_list_t m_tree_index;          // index in m_centroids of each row of m_tree_centroids
+		bool m_blocked = false;
+
+		algorithms::CentroidGroups<Dimension> m_groups;
+		bool m_approximate = false;
+
+		static value_matrix_t copy_centroids(value_view_t const& centroids);
+
+		size_t build(index_list_t& order, size_t begin, size_t end);
+
+		double axis_distance(double diff) const;
+
+		void search(size_t node, data_t const* data, distance_result_t& best) const;
+
+	public:
+
+		// the index keeps its own copy of the centroids
+		BasicCentroidIndex(value_view_t const& centroids, Distance const& distance = Distance());
+
+		BasicCentroidIndex(value_row_list_t const& centroids, Distance const& distance = Distance());
+
+		// approximate search, a row is usually but not always given its closest centroid, see approximate_t
+		BasicCentroidIndex(value_view_t const& centroids, approximate_t const& options, Distance const& distance = Distance());
+
+		bool is_approximate() const { return m_approximate; }
+
+		size_t size() const { return m_centroids.size(); }
+
+		size_t dimension() const { return m_centroids.dimension(); }
+
+		value_view_t centroids() const { return m_centroids; }
+
+		// the closest centroid of a row of dimension() values and its distance
+		distance_result_t find(data_t const* data) const;
+
+		distance_result_t find(data_row_t const& data) const { return find(data.data()); }
+
+		// the closest centroid of each row, rows are split over the pool
+		void find(data_view_t const& x_list, distance_result_t* results, ThreadPool& pool) const;
+
+		std::vector<distance_result_t> find(data_view_t const& x_list) const;
+	};
+
+
+	//======= CLASS METHODS ==============================
+
+	template<typename Distance, size_t Dimension>
+	BasicCentroidIndex<Distance, Dimension>::BasicCentroidIndex(value_view_t const& centroids, Distance const& distance)
+		: m_distance(distance), m_centroids(copy_centroids(centroids))
+	{
+		const auto num_clusters = centroids.size();
+		const auto data_size = centroids.dimension();
+
+		m_blocked = algorithms::use_blocked(m_distance, data_size);
+
+		bool use_tree = false;
+		if constexpr (algorithms::has_metric_type<Distance>::value)
+		{
+			// one axis bounds a manhattan distance less tightly, so its tree stops paying off at fewer dimensions
+			const auto metric = m_distance.metric();
+			const auto max_dimension = metric == metric_t::manhattan ? CLUSTER_INDEX_MAX_TREE_DIMENSION / 2 : CLUSTER_INDEX_MAX_TREE_DIMENSION;
+
+			use_tree = (metric == metric_t::squared_euclidean || metric == metric_t::manhattan)
+				&& data_size <= max_dimension && num_clusters >= CLUSTER_INDEX_MIN_TREE_CLUSTERS;
+		}
+
+		if (!use_tree)
+			return;
+
+		index_list_t order(num_clusters);
+		std::iota(order.begin(), order.end(), size_t(0));
+
+		build(order, 0, num_clusters);
+
+		m_tree_index = order;
+		m_tree_centroids = value_matrix_t(num_clusters, data_size);
+		for (size_t k = 0; k < num_clusters; ++k)
+			std::copy(m_centroids[order[k]], m_centroids[order[k]] + data_size, m_tree_centroids[k]);
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	BasicCentroidIndex<Distance, Dimension>::BasicCentroidIndex(value_row_list_t const& centroids, Distance const& distance)
+		: BasicCentroidIndex([&]()
+		{
+			value_matrix_t matrix(centroids.size(), centroids.empty() ? 0 : centroids[0].size());
+			for (size_t k = 0; k < centroids.size(); ++k)
+				std::copy(centroids[k].begin(), centroids[k].end(), matrix[k]);
+
+			return matrix;
+		}(), distance)
+	{
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	BasicCentroidIndex<Distance, Dimension>::BasicCentroidIndex(value_view_t const& centroids, approximate_t const& options, Distance const& distance)
+		: m_distance(distance), m_centroids(copy_centroids(centroids)), m_groups(options), m_approximate(true)
+	{
+		static ThreadPool serial(1);
+
+		m_groups.update(m_centroids, m_distance, serial);
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	value_matrix_t BasicCentroidIndex<Distance, Dimension>::copy_centroids(value_view_t const& centroids)
+	{
+		value_matrix_t matrix(centroids.size(), centroids.dimension());
+		for (size_t k = 0; k < centroids.size(); ++k)
+			std::copy(centroids[k], centroids[k] + centroids.dimension(), matrix[k]);
+
+		return matrix;
+	}
+
+
+	// splits the centroids order[begin, end) at the median of the dimension with the largest spread
+	// returns the index of the node
+	template<typename Distance, size_t Dimension>
+	size_t BasicCentroidIndex<Distance, Dimension>::build(index_list_t& order, size_t begin, size_t end)
+	{
+		const auto index = m_nodes.size();
+		m_nodes.push_back({ 0, 0, { 0, 0 }, begin, end });
+
+		if (end - begin <= leaf_size)
+			return index;
+
+		const auto data_size = m_centroids.dimension();
+
+		size_t split_dimension = 0;
+		double max_spread = -1;
+		for (size_t d = 0; d < data_size; ++d)
+		{
+			auto low = m_centroids[order[begin]][d];
+			auto high = low;
+			for (size_t i = begin + 1; i < end; ++i)
+			{
+				low = std::min(low, m_centroids[order[i]][d]);
+				high = std::max(high, m_centroids[order[i]][d]);
+			}
+
+			if (high - low > max_spread)
+			{
+				max_spread = high - low;
+				split_dimension = d;
+			}
+		}
+
+		const auto middle = begin + (end - begin) / 2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](size_t lhs, size_t rhs)
+		{
+			return m_centroids[lhs][split_dimension] < m_centroids[rhs][split_dimension];
+		});
+
+		// the children reorder their own ranges, so the split value is taken first
+		const auto split_value = m_centroids[order[middle]][split_dimension];
+
+		const auto below = build(order, begin, middle);
+		const auto above = build(order, middle, end);
+
+		auto& node = m_nodes[index];
+		node.split_dimension = split_dimension;
+		node.split_value = split_value;
+		node.children[0] = below;
+		node.children[1] = above;
+
+		return index;
+	}
+
+
+	// lower bound on the distance to any centroid on the other side of a split that is diff away along one axis
+	template<typename Distance, size_t Dimension>
+	double BasicCentroidIndex<Distance, Dimension>::axis_distance(double diff) const
+	{
+		if constexpr (algorithms::has_metric_type<Distance>::value)
+			return m_distance.metric() == metric_t::squared_euclidean ? diff * diff : std::abs(diff);
+		else
+			return 0; // the tree is only built for metrics with a known bound
+	}
+
+
+	// ties go to the lower centroid index, same as scanning every centroid
+	template<typename Distance, size_t Dimension>
+	void BasicCentroidIndex<Distance, Dimension>::search(size_t node_index, data_t const* data, distance_result_t& best) const
+	{
+		auto const& node = m_nodes[node_index];
+
+		if (!node.children[0])
+		{
+			const auto data_size = algorithms::dimension<Dimension>(m_tree_centroids);
+
+			for (size_t i = node.begin; i < node.end; ++i)
+			{
+				const auto dist = m_distance(data, m_tree_centroids[i], data_size);
+				const auto index = m_tree_index[i];
+
+				if (dist < best.distance || (dist == best.distance && index < best.index))
+					best = { index, dist };
+			}
+
+			return;
+		}
+
+		const auto diff = data[node.split_dimension] - node.split_value;
+		const size_t near = diff < 0 ? 0 : 1;
+
+		search(node.children[near], data, best);
+
+		if (axis_distance(diff) <= best.distance)
+			search(node.children[1 - near], data, best);
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	distance_result_t BasicCentroidIndex<Distance, Dimension>::find(data_t const* data) const
+	{
+		if (m_approximate)
+		{
+			std::vector<distance_result_t> scratch;
+			return m_groups.find(data, m_distance, scratch);
+		}
+
+		if (m_nodes.empty())
+		{
+			value_view_t centroids = m_centroids;
+			return algorithms::closest<Dimension>(m_distance, data, centroids);
+		}
+
+		distance_result_t best = { m_centroids.size(), std::numeric_limits<double>::max() };
+		search(0, data, best);
+
+		return best;
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	void BasicCentroidIndex<Distance, Dimension>::find(data_view_t const& x_list, distance_result_t* results, ThreadPool& pool) const
+	{
+		algorithms::for_each_range(pool, x_list.size(), [&](size_t, size_t begin, size_t end)
+		{
+			if (m_approximate)
+			{
+				std::vector<distance_result_t> scratch; // one for the range rather than one for each row
+
+				for (size_t i = begin; i < end; ++i)
+					results[i] = m_groups.find(x_list[i], m_distance, scratch);
+
+				return;
+			}
+
+			if (!m_blocked || !m_nodes.empty())
+			{
+				for (size_t i = begin; i < end; ++i)
+					results[i] = find(x_list[i]);
+
+				return;
+			}
+
+			// the centroids are reused from cache by a block of rows at a time
+			constexpr size_t block_size = 256;
+			double norms[block_size];
+			size_t indexes[block_size];
+			double distances[block_size];
+
+			for (size_t block = begin; block < end; block += block_size)
+			{
+				const auto num_rows = std::min(block + block_size, end) - block;
+
+				squared_norms(x_list[block], num_rows, x_list.stride(), x_list.dimension(), norms);
+				closest_squared_euclidean(x_list[block], num_rows, x_list.stride(), norms,
+					m_centroids.data(), m_centroids.size(), m_centroids.stride(), m_centroids.dimension(), indexes, distances);
+
+				for (size_t i = 0; i < num_rows; ++i)
+					results[block + i] = { indexes[i], distances[i] };
+			}
+		});
+	}
+
+
+	template<typename Distance, size_t Dimension>
+	std::vector<distance_result_t> BasicCentroidIndex<Distance, Dimension>::find(data_view_t const& x_list) const
+	{
+		static ThreadPool serial(1);
+
+		std::vector<distance_result_t> results(x_list.size());
+		find(x_list, results.data(), serial);
+
+		return results;
+	}
+}
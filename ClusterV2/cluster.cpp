@@ -1,333 +1,170 @@
-#include "cluster_config.hpp"
+#include "cluster.hpp"
 
-#include <cstdlib>
 #include <algorithm>
-#include <random>
-#include <iterator>
-#include <iostream>
-#include <functional>
+#include <cmath>
 
 namespace cluster
 {
-	//======= DATA FUNCTIONS =======================
+	template class BasicCluster<ErasedDistance, to_value_funct_t>;
+	template class BasicCentroidIndex<ErasedDistance>;
 
 
-	template<typename LHS_t, typename RHS_t>
-	double distance_squared(LHS_t lhs, RHS_t rhs)
-	{
-		constexpr auto square = [](auto val) { return val * val; };
-
-		return square(static_cast<double>(lhs) - static_cast<double>(rhs));
-	}
-
+	//======= TYPE ERASED POLICIES =======================
 
-	// calculates the average spared difference
-	template<typename T>
-	double list_distance(std::vector<T> const& lhs, std::vector<T> const& rhs)
+	ErasedDistance::ErasedDistance()
 	{
-		double sum = 0;
-		//auto size = std::min(lhs.size(), rhs.size());
-		const auto size = lhs.size();
-
-		for (size_t i = 0; i < size; ++i)
-			sum += distance_squared(lhs[i], rhs[i]);
-
-		return sum / size;
-	}
-
-
-	//====== INITIALIZE DATA ==================
+		// squared euclidean, until a custom distance replaces it
+		m_row_distance = [](data_t const* data, value_t const* centroid, size_t size)
+		{
+			double sum = 0;
+			for (size_t i = 0; i < size; ++i)
+				sum += (data[i] - centroid[i]) * (data[i] - centroid[i]);
 
-	// define how to initialize values based on type of value_row_t
-	// used for initializing centroids
-	value_row_t make_value_row(size_t capacity)
-	{
-		std::vector<value_t> row(capacity);
+			return sum;
+		};
 
-		return row;
-	}
+		m_distance = [row_distance = m_row_distance](data_row_t const& data, value_row_t const& centroid)
+		{
+			return row_distance(data.data(), centroid.data(), std::min(data.size(), centroid.size()));
+		};
 
-	value_row_list_t make_value_row_list(size_t list_capacity, size_t row_capacity)
-	{
-		std::vector<value_row_t> list(list_capacity, make_value_row(row_capacity));
-		return list;
+		set_metric(metric_t::squared_euclidean);
 	}
 
 
-	//======= TYPES ===================
-
-	typedef struct ClusterCount // used for tracking the number of times a given result is found
-	{
-		cluster_result_t result;
-		unsigned count;
-
-	} cluster_count_t;
-
-	using closest_t = std::function<distance_result_t(data_row_t const& data, value_row_list_t const& value_list)>;
-
-	using cluster_once_t = std::function<cluster_result_t(data_row_list_t const& x_list, size_t num_clusters)>;
-
-	
-	//======= HELPERS ====================
-
-	static size_t max_value(index_list_t const& list)
+	void ErasedDistance::set_metric(metric_t metric)
 	{
-		return *std::max_element(list.begin(), list.end());
-	}
-
+		m_metric = metric;
+		m_kernel = distance_kernel(metric);
 
-	// convert a list of data_row_t to value_row_t
-	static value_row_list_t to_value_row_list(data_row_list_t const& data_row_list, to_value_funct_t const& converter)
-	{
-		auto list = make_value_row_list(data_row_list.size(), data_row_list[0].size());
-		for (size_t i = 0; i < data_row_list.size(); ++i)
+		// a custom distance set later starts again without the other function
+		if (metric != metric_t::custom)
 		{
-			auto data_row = data_row_list[i];
-			for (size_t j = 0; j < data_row.size(); ++j)
-				list[i][j] = converter(data_row[j]);
+			m_custom_distance = false;
+			m_custom_row_distance = false;
 		}
-
-		return list;
 	}
 
 
-	// selects random data to be used as centroids
-	static value_row_list_t get_random_centroids(data_row_list_t const& x_list, size_t num_clusters, to_value_funct_t const& converter)
-	{
-		// C++ 17 std::sample
-
-		data_row_list_t samples;
-		samples.reserve(num_clusters);
-
-		std::sample(x_list.begin(), x_list.end(), std::back_inserter(samples),
-			num_clusters, std::mt19937{ std::random_device{}() });
-
-		return to_value_row_list(samples, converter);
-	}
-		
-
-	// assigns a cluster index to each data point
-	static cluster_result_t assign_clusters(data_row_list_t const& x_list, value_row_list_t& centroids, closest_t const& closest)
+	// contiguous rows are copied into nested rows for a function that only takes those
+	void ErasedDistance::set_distance(dist_func_t const& f)
 	{
-		index_list_t x_clusters;
-		x_clusters.reserve(x_list.size());
+		m_distance = f;
+		m_custom_distance = true;
+		m_metric = metric_t::custom;
 
-		double total_distance = 0;
+		if (m_custom_row_distance)
+			return;
 
-		for (auto const& x_data : x_list)
+		m_row_distance = [f](data_t const* data, value_t const* centroid, size_t size)
 		{
-			auto c = closest(x_data, centroids);
+			thread_local data_row_t data_row;
+			thread_local value_row_t centroid_row;
 
-			x_clusters.push_back(c.index);
-			total_distance += c.distance;
-		}
+			data_row.assign(data, data + size);
+			centroid_row.assign(centroid, centroid + size);
 
-		cluster_result_t res = { std::move(x_clusters), std::move(centroids), total_distance / x_list.size() };
-		return res;
+			return f(data_row, centroid_row);
+		};
 	}
 
 
-	// finds new centroids based on the averages of data clustered together
-	static value_row_list_t calc_centroids(data_row_list_t const& x_list, index_list_t const& x_clusters, size_t num_clusters, to_value_funct_t const& converter)
+	void ErasedDistance::set_row_distance(row_dist_func_t const& f)
 	{
-		const auto data_size = x_list[0].size();
-		auto values = make_value_row_list(num_clusters, data_size);		
-		
-		std::vector<unsigned> counts(num_clusters, 0);
-
-		for (size_t i = 0; i < x_list.size(); ++i)
-		{
-			const auto cluster_index = x_clusters[i];
-			++counts[cluster_index];
+		m_row_distance = f;
+		m_custom_row_distance = true;
+		m_metric = metric_t::custom;
 
-			for (size_t d = 0; d < data_size; ++d)
-				values[cluster_index][d] += converter(x_list[i][d]); // totals for each cluster
-		}
+		if (m_custom_distance)
+			return;
 
-		for (size_t k = 0; k < num_clusters; ++k)
+		m_distance = [f](data_row_t const& data, value_row_t const& centroid)
 		{
-			for (size_t d = 0; d < data_size; ++d)
-				values[k][d] = values[k][d] / counts[k]; // convert to average
-		}
-
-		return values;
+			return f(data.data(), centroid.data(), std::min(data.size(), centroid.size()));
+		};
 	}
 
 
-	// re-label cluster assignments so that they are consistent accross iterations
-	static void relabel_clusters(cluster_result_t& result, size_t num_clusters)
+	bool ErasedDistance::is_metric() const
 	{
-		std::vector<uint8_t> flags(num_clusters, 0); // tracks if cluster index has been mapped
-		std::vector<size_t> map(num_clusters, 0);    // maps old cluster index to new cluster index
+		return m_metric == metric_t::squared_euclidean || m_metric == metric_t::manhattan;
+	}
 
-		const auto all_flagged = [&]()
-		{
-			for (auto const flag : flags)
-			{
-				if (!flag)
-					return false;
-			}
 
-			return true;
-		};
+	double ErasedDistance::to_metric(double distance) const
+	{
+		return m_metric == metric_t::squared_euclidean ? std::sqrt(distance) : distance;
+	}
 
-		size_t i = 0;
-		size_t label = 0;
 
-		for (; label < num_clusters && i < result.x_clusters.size() && !all_flagged(); ++i)
-		{
-			size_t c = result.x_clusters[i];
-			if (flags[c])
-				continue;
+	double ErasedDistance::operator()(data_row_t const& data, value_row_t const& centroid, size_t size) const
+	{
+		if (m_metric == metric_t::custom)
+			return m_distance(data, centroid);
 
-			map[c] = label;
-			flags[c] = 1;
-			++label;
-		}
+		double dist = 0;
+		m_kernel(data.data(), centroid.data(), 1, 0, size, &dist);
 
-		// re-label cluster assignments
-		for (i = 0; i < result.x_clusters.size(); ++i)
-		{
-			size_t c = result.x_clusters[i];
-			result.x_clusters[i] = map[c];
-		}
+		return dist;
 	}
 
 
-	//======= CLUSTERING ALGORITHMS ==========================
-	
-
-	// returns the result with the smallest distance
-	static cluster_result_t cluster_min_distance(data_row_list_t const& x_list, size_t num_clusters, cluster_once_t const& cluster_once)
+	double ErasedDistance::operator()(data_t const* data, value_t const* centroid, size_t size) const
 	{
-		auto result = cluster_once(x_list, num_clusters);
-		auto min = result;
+		if (m_metric == metric_t::custom)
+			return m_row_distance(data, centroid, size);
 
-		for (size_t i = 0; i < CLUSTER_ATTEMPTS; ++i)
-		{
-			result = cluster_once(x_list, num_clusters);
-			if (result.average_distance < min.average_distance)
-				min = std::move(result);
-		}
+		double dist = 0;
+		m_kernel(data, centroid, 1, 0, size, &dist);
 
-		return min;
+		return dist;
 	}
-	
-	/*
 
-	// returns the most popular result
-	// stops when the same result has been found for more than half of the attempts
-	static cluster_result_t cluster_max_count(data_row_list_t const& x_list, size_t num_clusters, cluster_once_t const& cluster_once)
-	{
-		std::vector<cluster_count_t> counts;
-		counts.reserve(CLUSTER_ATTEMPTS);
 
-		auto result = cluster_once(x_list, num_clusters);
-		counts.push_back({ std::move(result), 1 });
+	distance_result_t ErasedDistance::closest(data_t const* data, value_view_t const& centroids) const
+	{
+		const auto data_size = centroids.dimension();
 
-		for (size_t i = 0; i < CLUSTER_ATTEMPTS; ++i)
+		if (m_metric == metric_t::custom)
 		{
-			result = cluster_once(x_list, num_clusters);
+			distance_result_t res = { 0, m_row_distance(data, centroids[0], data_size) };
 
-			bool add_clusters = true;
-			for (auto& c : counts)
+			for (size_t i = 1; i < centroids.size(); ++i)
 			{
-				if (list_distance(result.x_clusters, c.result.x_clusters) != 0)
-					continue;
-
-				++c.count;
-				if (c.count > CLUSTER_ATTEMPTS / 2)
-					return c.result;
-
-				add_clusters = false;
-				break;
+				auto dist = m_row_distance(data, centroids[i], data_size);
+				if (dist < res.distance)
+				{
+					res.distance = dist;
+					res.index = i;
+				}
 			}
 
-			if (add_clusters)
-			{
-				counts.push_back({ std::move(result), 1 });
-			}
+			return res;
 		}
 
-		auto constexpr comp = [](cluster_count_t const& lhs, cluster_count_t const& rhs) { return lhs.count < rhs.count; };
-		auto const best = *std::max_element(counts.begin(), counts.end(), comp);
-
-		return best.result;
-	}
-
-	*/
+		constexpr size_t block_size = 16;
+		double distances[block_size];
 
+		distance_result_t res = { 0, 0 };
 
-	//======= CLASS METHODS ==============================
+		for (size_t begin = 0; begin < centroids.size(); begin += block_size)
+		{
+			const auto count = std::min(block_size, centroids.size() - begin);
+			m_kernel(data, centroids[begin], count, centroids.stride(), data_size, distances);
 
-	distance_result_t Cluster::closest(data_row_t const& data, value_row_list_t const& value_list) const
-	{
-		distance_result_t res = { 0, m_distance(data, value_list[0]) };
+			if (begin == 0)
+				res.distance = distances[0];
 
-		for (size_t i = 1; i < value_list.size(); ++i)
-		{
-			auto dist = m_distance(data, value_list[i]);
-			if (dist < res.distance)
+			for (size_t i = 0; i < count; ++i)
 			{
-				res.distance = dist;
-				res.index = i;
+				if (distances[i] < res.distance)
+				{
+					res.distance = distances[i];
+					res.index = begin + i;
+				}
 			}
 		}
 
 		return res;
 	}
-
-
-
-	size_t Cluster::find_centroid(data_row_t const& data, value_row_list_t const& centroids) const
-	{
-		auto result = closest(data, centroids);
-
-		return result.index;
-	}
-
-
-	cluster_result_t Cluster::cluster_once(data_row_list_t const& x_list, size_t num_clusters) const
-	{
-		auto const closest_f = [&](data_row_t const& data, value_row_list_t const& value_list)
-		{
-			return closest(data, value_list);
-		};
-
-		auto centroids = get_random_centroids(x_list, num_clusters, m_to_value); // start with random data as centroids
-
-		auto result = assign_clusters(x_list, centroids, closest_f);
-		relabel_clusters(result, num_clusters);
-
-		for (size_t i = 0; i < CLUSTER_ITERATIONS; ++i)
-		{
-			centroids = calc_centroids(x_list, result.x_clusters, num_clusters, m_to_value);
-			auto res_try = assign_clusters(x_list, centroids, closest_f);
-
-			if (max_value(res_try.x_clusters) < num_clusters - 1)
-				continue;
-
-			auto res_old = std::move(result);
-			result = std::move(res_try);
-			relabel_clusters(result, num_clusters);
-
-			if (list_distance(res_old.x_clusters, result.x_clusters) == 0)
-				return result;
-		}
-
-		return result;
-	}
-
-
-	cluster_result_t Cluster::cluster_data(data_row_list_t const& x_list, size_t num_clusters) const
-	{
-		// wrap member function in a lambda to pass it to algorithm
-		auto const cluster_once_f = [&](data_row_list_t const& x_list, size_t num_clusters)
-		{
-			return cluster_once(x_list, num_clusters);
-		};
-
-		return cluster_min_distance(x_list, num_clusters, cluster_once_f);
-	}
 }
-
@@ -1,95 +1,119 @@
 #pragma once
 
-
-#include <vector>
-#include <functional>
-#include <cstdint>
+#include "basic_cluster.hpp"
+#include "centroid_index.hpp"
+#include "distance.hpp"
 
 namespace cluster
 {
+	//======= TYPE ERASED POLICIES =======================
 
+	// distance chosen at runtime, either a built-in metric or custom functions
+	class ErasedDistance
+	{
+	private:
 
-	//======= CLASS DEFINITION =======================	
+		metric_t m_metric = metric_t::squared_euclidean;
+		distance_kernel_t m_kernel = nullptr;
+
+		dist_func_t m_distance;
+		row_dist_func_t m_row_distance;
+
+		// which functions were set by the user, the other one calls it
+		bool m_custom_distance = false;
+		bool m_custom_row_distance = false;
 
-	class Cluster // allows for custom function to calculate distance between data and centroid
-	{
 	public:
 
-		using value_t = double; // value type of centroids
-		using data_t = double;
+		ErasedDistance();
 
-		using data_row_t = std::vector<value_t>;
-		using data_row_list_t = std::vector<data_row_t>;
+		void set_metric(metric_t metric);
 
-		using value_row_t = std::vector<value_t>;
-		using value_row_list_t = std::vector<value_row_t>;
+		void set_distance(dist_func_t const& f);
 
-		using index_list_t = std::vector<size_t>;
+		void set_row_distance(row_dist_func_t const& f);
 
-		using dist_func_t = std::function<double(data_row_t const& data, value_row_t const& centroid)>;
-		using to_value_funct_t = std::function<value_t(data_t data)>;
+		// metric_t::custom when distance functions have been set
+		metric_t metric() const { return m_metric; }
 
+		// squared euclidean and manhattan can be used by the bound based algorithms
+		bool is_metric() const;
 
-		typedef struct ClusterResult
-		{
-			index_list_t x_clusters;      // the cluster index of each data point
-			value_row_list_t centroids;   // centroids found
-			value_t average_distance = 0; // 
+		double to_metric(double distance) const;
 
-		} cluster_result_t;
+		double operator()(data_row_t const& data, value_row_t const& centroid, size_t size) const;
 
+		double operator()(data_t const* data, value_t const* centroid, size_t size) const;
 
-		typedef struct DistanceResult
-		{
-			size_t index;    // index of centroid in the list
-			double distance; // calculated distance of data from the centroid
+		// the built-in metrics compare the row against a block of centroids at a time
+		distance_result_t closest(data_t const* data, value_view_t const& centroids) const;
+	};
 
-		} distance_result_t;
 
-	private:
+	//======= CLASS DEFINITION =======================	
 
-		dist_func_t m_distance;
-		to_value_funct_t m_to_value;
+	class Cluster : public BasicCluster<ErasedDistance, to_value_funct_t> // allows for custom function to calculate distance between data and centroid
+	{
+	public:
 
-		distance_result_t closest(data_row_t const& data, value_row_list_t const& value_list) const;
+		using value_t = cluster::value_t; // value type of centroids
+		using data_t = cluster::data_t;
 
-		cluster_result_t cluster_once(data_row_list_t const& x_list, size_t num_clusters) const;
+		using data_row_t = cluster::data_row_t;
+		using data_row_list_t = cluster::data_row_list_t;
+
+		using value_row_t = cluster::value_row_t;
+		using value_row_list_t = cluster::value_row_list_t;
+
+		using data_matrix_t = cluster::data_matrix_t;
+		using data_view_t = cluster::data_view_t;
+
+		using value_matrix_t = cluster::value_matrix_t;
+		using value_view_t = cluster::value_view_t;
+
+		using index_list_t = cluster::index_list_t;
+
+		using dist_func_t = cluster::dist_func_t;
+		using row_dist_func_t = cluster::row_dist_func_t;
+		using to_value_funct_t = cluster::to_value_funct_t;
+
+		using cluster_result_t = cluster::cluster_result_t;
+		using matrix_result_t = cluster::matrix_result_t;
+		using parallel_t = cluster::parallel_t;
+		using selection_t = cluster::selection_t;
+		using distance_result_t = cluster::distance_result_t;
+		using cluster_workspace_t = cluster::cluster_workspace_t;
+		using matrix_workspace_t = cluster::matrix_workspace_t;
 
-	public:
 
 		Cluster()
 		{
-			m_distance = [](data_row_t const& data, value_row_t const& centroid) { return 0.0; };
 			m_to_value = [](data_t data) { return data; };
 		}
 
+		// use a built-in distance, runs vectorized kernels for the instruction set of this cpu
+		// the default is metric_t::squared_euclidean
+		void set_metric(metric_t metric) { m_distance.set_metric(metric); }
+
 		// define how distance is calculated between data and a centroid
-		void set_distance(dist_func_t const& f) { m_distance = f; }
+		// replaces the built-in metric, and is also used for contiguous rows unless set_row_distance is called
+		void set_distance(dist_func_t const& f) { m_distance.set_distance(f); }
+
+		// define how distance is calculated between contiguous rows of data and centroids
+		// replaces the built-in metric, and is also used for nested rows unless set_distance is called
+		void set_row_distance(row_dist_func_t const& f) { m_distance.set_row_distance(f); }
 
 		// define how a data value is to be interpreted as if it were a centroid value
 		// used when building a new centroid from a set of data
 		void set_to_value(to_value_funct_t const& f) { m_to_value = f; }
-
-		// determines clusters given the data and the number of clusters
-		cluster_result_t cluster_data(data_row_list_t const& x_list, size_t num_clusters) const;
-
-		// The index of the closest centroid for the given data row
-		size_t find_centroid(data_row_t const& data, value_row_list_t const& centroids) const;
 	};
 
 
-	using value_t = Cluster::value_t;
-	using data_t = Cluster::data_t;
-	using cluster_result_t = Cluster::cluster_result_t;
-	using distance_result_t = Cluster::distance_result_t;
-	using data_row_t = Cluster::data_row_t;
-	using data_row_list_t = Cluster::data_row_list_t;
-	using value_row_t = Cluster::value_row_t;
-	using value_row_list_t = Cluster::value_row_list_t;
-	using index_list_t = Cluster::index_list_t;
-	using dist_func_t = Cluster::dist_func_t;
-	using to_value_funct_t = Cluster::to_value_funct_t;
-
-}
+	// closest centroid searches with the distance of a Cluster, see cluster.distance()
+	using CentroidIndex = BasicCentroidIndex<ErasedDistance>;
 
 
+	// compiled once in cluster.cpp
+	extern template class BasicCluster<ErasedDistance, to_value_funct_t>;
+	extern template class BasicCentroidIndex<ErasedDistance>;
+}
@@ -0,0 +1,951 @@
+#pragma once
+
+#include "cluster_types.hpp"
+#include "cluster_config.hpp"
+#include "cluster_observer.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <random>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include <cmath>
+
+// building blocks of the clustering algorithms
+// templates over the row containers (nested vectors or contiguous matrices),
+// the distance and conversion policies and the number of values in each row
+namespace cluster
+{
+	namespace algorithms
+	{
+		//====== INITIALIZE DATA ==================
+
+		// define how to initialize values based on type of value_row_t
+		// used for initializing centroids
+		inline value_row_t make_value_row(size_t capacity)
+		{
+			std::vector<value_t> row(capacity);
+
+			return row;
+		}
+
+		inline value_row_list_t make_value_row_list(size_t list_capacity, size_t row_capacity)
+		{
+			std::vector<value_row_t> list(list_capacity, make_value_row(row_capacity));
+			return list;
+		}
+
+
+		//======= TYPES ===================
+
+		// used for tracking the number of times a given result is found
+		template<typename Result>
+		struct ResultCount
+		{
+			Result result;
+			unsigned count;
+			uint64_t hash; // of the cluster labels
+		};
+
+		// totals of the data in each cluster
+		template<typename C>
+		struct ClusterSums
+		{
+			C values;                     // sum of the data values in each cluster
+			std::vector<unsigned> counts; // number of data points in each cluster
+		};
+
+		template<typename C>
+		using cluster_sums_t = ClusterSums<C>;
+
+		typedef struct Assignment
+		{
+			double total_distance;
+			size_t changed; // rows assigned to a different cluster than before
+
+		} assignment_t;
+
+		// scratch space of the passes over the data, kept so that repeated iterations and attempts do not allocate
+		template<typename C>
+		struct ClusterBuffers
+		{
+			std::vector<cluster_sums_t<C>> range_sums; // totals of each thread's range of data
+			std::vector<double> totals;                // distance of each range
+			std::vector<size_t> changes;               // changed rows of each range
+			std::vector<double> min_distances;         // k-means++ seeding
+			std::vector<uint8_t> flags;                // relabelling
+			std::vector<size_t> map;                   //
+			std::vector<unsigned> counts;              //
+			C copy;                                    //
+		};
+
+		// everything one clustering attempt works on, including its result
+		template<typename Result>
+		struct AttemptWorkspace
+		{
+			using centroids_t = decltype(Result::centroids);
+
+			Result result;
+			centroids_t centroids_try;
+			index_list_t x_clusters_try;
+			cluster_sums_t<centroids_t> sums;
+			cluster_sums_t<centroids_t> sums_try;
+			ClusterBuffers<centroids_t> buffers;
+		};
+
+		// a distance policy can search contiguous centroids itself, e.g. with vectorized kernels
+		// distance_result_t closest(data_t const* data, value_view_t const& centroids) const;
+		template<typename D, typename = void>
+		struct has_closest : std::false_type {};
+
+		template<typename D>
+		struct has_closest<D, std::void_t<decltype(std::declval<D const&>().closest(std::declval<data_t const*>(), std::declval<value_view_t>()))>> : std::true_type {};
+
+
+		// a distance policy can find the closest centroids of a range of rows itself
+		// bool covers(data_view_t const& x_list) const;
+		// void closest_rows(size_t begin, size_t end, value_view_t const& centroids, size_t* indexes, double* distances) const;
+		template<typename D, typename = void>
+		struct has_closest_rows : std::false_type {};
+
+		template<typename D>
+		struct has_closest_rows<D, std::void_t<decltype(std::declval<D const&>().closest_rows(0, 0, std::declval<value_view_t>(), nullptr, nullptr))>> : std::true_type {};
+
+
+		// the bound based algorithms need a distance that obeys the triangle inequality
+		// a distance policy opts in by converting its distance to such a metric, e.g. sqrt of a squared distance
+		// bool is_metric() const;
+		// double to_metric(double distance) const;
+		template<typename D, typename = void>
+		struct has_metric : std::false_type {};
+
+		template<typename D>
+		struct has_metric<D, std::void_t<decltype(std::declval<D const&>().is_metric()), decltype(std::declval<D const&>().to_metric(0.0))>> : std::true_type {};
+
+
+		//======= HELPERS ====================
+
+		// splitmix64, gives well separated seeds for consecutive inputs
+		inline uint64_t mix_seed(uint64_t value)
+		{
+			value += 0x9E3779B97F4A7C15ull;
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+			return value ^ (value >> 31);
+		}
+
+
+		// random seed of a single clustering attempt
+		inline uint64_t attempt_seed(uint64_t master_seed, size_t attempt)
+		{
+			return mix_seed(master_seed ^ mix_seed(attempt));
+		}
+
+
+		// number of pieces data is split into for processing in parallel
+		// small lists are not worth splitting
+		inline size_t num_data_ranges(ThreadPool const& pool, size_t size)
+		{
+			constexpr size_t min_range_size = 1024;
+
+			return std::max(std::min(pool.size(), size / min_range_size), size_t(1));
+		}
+
+
+		// number of values in each row of a list
+		inline size_t row_size(data_row_list_t const& list)
+		{
+			return list[0].size();
+		}
+
+
+		template<typename T>
+		size_t row_size(MatrixView<T> const& list)
+		{
+			return list.dimension();
+		}
+
+
+		template<typename T>
+		size_t row_size(Matrix<T> const& list)
+		{
+			return list.dimension();
+		}
+
+
+		template<typename D>
+		bool is_metric(D const& distance)
+		{
+			if constexpr (has_metric<D>::value)
+				return distance.is_metric();
+			else
+				return false;
+		}
+
+
+		// number of values in each row, known at compile time when Dimension is given
+		template<size_t Dimension, typename L>
+		size_t dimension(L const& list)
+		{
+			if constexpr (Dimension != dynamic_dimension)
+				return Dimension;
+			else
+				return row_size(list);
+		}
+
+
+		// new centroids with all values set to zero
+		template<typename C>
+		C make_centroids(size_t num_clusters, size_t data_size);
+
+
+		template<>
+		inline value_row_list_t make_centroids<value_row_list_t>(size_t num_clusters, size_t data_size)
+		{
+			return make_value_row_list(num_clusters, data_size);
+		}
+
+
+		template<>
+		inline value_matrix_t make_centroids<value_matrix_t>(size_t num_clusters, size_t data_size)
+		{
+			return value_matrix_t(num_clusters, data_size);
+		}
+
+
+		// sets centroids to num_clusters rows of zeros, the storage is reused when the shape is unchanged
+		template<typename C>
+		void zero_centroids(C& centroids, size_t num_clusters, size_t data_size)
+		{
+			if (centroids.size() != num_clusters || (num_clusters && row_size(centroids) != data_size))
+			{
+				centroids = make_centroids<C>(num_clusters, data_size);
+				return;
+			}
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				for (size_t d = 0; d < data_size; ++d)
+					centroids[k][d] = 0;
+			}
+		}
+
+
+		template<typename C>
+		void zero_sums(cluster_sums_t<C>& sums, size_t num_clusters, size_t data_size)
+		{
+			zero_centroids(sums.values, num_clusters, data_size);
+			sums.counts.assign(num_clusters, 0);
+		}
+
+
+		// selects random data to be used as centroids
+		template<size_t Dimension, typename L, typename C, typename T>
+		void set_random_centroids(L const& x_list, size_t num_clusters, T const& converter, uint64_t seed, C& centroids)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+			zero_centroids(centroids, num_clusters, data_size);
+
+			std::mt19937_64 gen{ seed };
+
+			// selection sampling, same as std::sample without copying the rows
+			size_t remaining = x_list.size();
+			size_t k = 0;
+			for (size_t i = 0; i < x_list.size() && k < num_clusters; ++i, --remaining)
+			{
+				if (std::uniform_int_distribution<size_t>(0, remaining - 1)(gen) >= num_clusters - k)
+					continue;
+
+				for (size_t d = 0; d < data_size; ++d)
+					centroids[k][d] = converter(x_list[i][d]);
+
+				++k;
+			}
+		}
+
+
+		// finds the centroid closest to a data row
+		template<size_t Dimension, typename D, typename R, typename C>
+		distance_result_t closest(D const& distance, R const& data, C const& centroids)
+		{
+			constexpr bool contiguous = std::is_convertible_v<R const&, data_t const*> && std::is_convertible_v<C const&, value_view_t>;
+
+			if constexpr (contiguous && has_closest<D>::value)
+			{
+				return distance.closest(data, centroids);
+			}
+			else
+			{
+				const auto data_size = dimension<Dimension>(centroids);
+
+				distance_result_t res = { 0, distance(data, centroids[0], data_size) };
+
+				for (size_t i = 1; i < centroids.size(); ++i)
+				{
+					auto dist = distance(data, centroids[i], data_size);
+					if (dist < res.distance)
+					{
+						res.distance = dist;
+						res.index = i;
+					}
+				}
+
+				return res;
+			}
+		}
+
+
+		// splits [0, size) into one contiguous range per thread and runs f(range, begin, end) for each
+		template<typename F>
+		void for_each_range(ThreadPool& pool, size_t size, F const& f)
+		{
+			const auto num_ranges = num_data_ranges(pool, size);
+
+			auto const task = [&](size_t range)
+			{
+				f(range, size * range / num_ranges, size * (range + 1) / num_ranges);
+			};
+
+			pool.run(num_ranges, std::cref(task)); // a reference does not allocate in std::function
+		}
+
+
+		// assigns a cluster index to each data point and counts the rows whose index is not the one in previous
+		// the totals of the data in each cluster are gathered in the same pass
+		// each thread totals its own range of data, the totals are then combined
+		// previous and x_clusters can be the same list
+		template<size_t Dimension, typename L, typename C, typename D, typename T>
+		assignment_t assign_labels(L const& x_list, C const& centroids, D const& distance, T const& converter, ThreadPool& pool, index_list_t const& previous, index_list_t& x_clusters, cluster_sums_t<C>& sums, ClusterBuffers<C>& buffers)
+		{
+			const auto num_clusters = centroids.size();
+			const auto data_size = dimension<Dimension>(x_list);
+			const auto num_ranges = num_data_ranges(pool, x_list.size());
+
+			auto& totals = buffers.totals;
+			auto& changes = buffers.changes;
+			auto& range_sums = buffers.range_sums;
+
+			totals.assign(num_ranges, 0);
+			changes.assign(num_ranges, 0);
+			range_sums.resize(num_ranges);
+
+			for_each_range(pool, x_list.size(), [&](size_t range, size_t begin, size_t end)
+			{
+				zero_sums(range_sums[range], num_clusters, data_size);
+
+				auto& values = range_sums[range].values;
+				auto& counts = range_sums[range].counts;
+
+				double total = 0;
+				size_t changed = 0;
+				auto const add_row = [&](size_t i, size_t index, double dist)
+				{
+					changed += previous[i] != index;
+					x_clusters[i] = index;
+					total += dist;
+
+					++counts[index];
+					for (size_t d = 0; d < data_size; ++d)
+						values[index][d] += converter(x_list[i][d]); // totals for each cluster
+				};
+
+				if constexpr (has_closest_rows<D>::value && std::is_convertible_v<L const&, data_view_t> && std::is_convertible_v<C const&, value_view_t>)
+				{
+					if (distance.covers(x_list))
+					{
+						constexpr size_t block_size = 1024;
+						size_t indexes[block_size];
+						double distances[block_size];
+
+						for (size_t block = begin; block < end; block += block_size)
+						{
+							const auto block_end = std::min(block + block_size, end);
+							distance.closest_rows(block, block_end, centroids, indexes, distances);
+
+							for (size_t i = block; i < block_end; ++i)
+								add_row(i, indexes[i - block], distances[i - block]);
+						}
+
+						totals[range] = total;
+						changes[range] = changed;
+						return;
+					}
+				}
+
+				for (size_t i = begin; i < end; ++i)
+				{
+					auto c = closest<Dimension>(distance, x_list[i], centroids);
+					add_row(i, c.index, c.distance);
+				}
+
+				totals[range] = total;
+				changes[range] = changed;
+			});
+
+			std::swap(sums, range_sums[0]); // both keep their storage for the next pass
+
+			for (size_t r = 1; r < num_ranges; ++r)
+			{
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					sums.counts[k] += range_sums[r].counts[k];
+
+					for (size_t d = 0; d < data_size; ++d)
+						sums.values[k][d] += range_sums[r].values[k][d];
+				}
+			}
+
+			assignment_t res = { 0, 0 };
+			for (size_t r = 0; r < num_ranges; ++r)
+			{
+				res.total_distance += totals[r];
+				res.changed += changes[r];
+			}
+
+			return res;
+		}
+
+
+		// assigns a cluster index to each data point, the centroids are moved into the result
+		template<typename Result, size_t Dimension, typename L, typename C, typename D, typename T>
+		Result assign_clusters(L const& x_list, C& centroids, D const& distance, T const& converter, ThreadPool& pool, cluster_sums_t<C>& sums)
+		{
+			ClusterBuffers<C> buffers;
+			index_list_t x_clusters(x_list.size(), centroids.size());
+			const auto assignment = assign_labels<Dimension>(x_list, centroids, distance, converter, pool, x_clusters, x_clusters, sums, buffers);
+
+			Result res = { std::move(x_clusters), std::move(centroids), assignment.total_distance / x_list.size() };
+			return res;
+		}
+
+
+		// totals of the data in each cluster for rows that are already assigned
+		template<size_t Dimension, typename C, typename L, typename T>
+		cluster_sums_t<C> total_clusters(L const& x_list, index_list_t const& x_clusters, size_t num_clusters, T const& converter, ThreadPool& pool)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+			const auto num_ranges = num_data_ranges(pool, x_list.size());
+
+			std::vector<cluster_sums_t<C>> range_sums(num_ranges, { make_centroids<C>(num_clusters, data_size), std::vector<unsigned>(num_clusters, 0) });
+
+			for_each_range(pool, x_list.size(), [&](size_t range, size_t begin, size_t end)
+			{
+				auto& values = range_sums[range].values;
+				auto& counts = range_sums[range].counts;
+
+				for (size_t i = begin; i < end; ++i)
+				{
+					const auto c = x_clusters[i];
+					++counts[c];
+
+					for (size_t d = 0; d < data_size; ++d)
+						values[c][d] += converter(x_list[i][d]);
+				}
+			});
+
+			auto sums = std::move(range_sums[0]);
+
+			for (size_t r = 1; r < num_ranges; ++r)
+			{
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					sums.counts[k] += range_sums[r].counts[k];
+
+					for (size_t d = 0; d < data_size; ++d)
+						sums.values[k][d] += range_sums[r].values[k][d];
+				}
+			}
+
+			return sums;
+		}
+
+
+		// average distance of each row from the centroid of its cluster
+		template<size_t Dimension, typename L, typename C, typename D>
+		double average_distance(L const& x_list, index_list_t const& x_clusters, C const& centroids, D const& distance, ThreadPool& pool)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+			std::vector<double> totals(num_data_ranges(pool, x_list.size()), 0);
+
+			for_each_range(pool, x_list.size(), [&](size_t range, size_t begin, size_t end)
+			{
+				double total = 0;
+				for (size_t i = begin; i < end; ++i)
+					total += distance(x_list[i], centroids[x_clusters[i]], data_size);
+
+				totals[range] = total;
+			});
+
+			double total_distance = 0;
+			for (auto const total : totals)
+				total_distance += total;
+
+			return total_distance / x_list.size();
+		}
+
+
+		// finds new centroids based on the averages of data clustered together
+		// a cluster without data keeps its previous centroid
+		template<size_t Dimension, typename C>
+		C calc_centroids(cluster_sums_t<C> const& sums, C const& previous)
+		{
+			const auto num_clusters = sums.counts.size();
+			const auto data_size = dimension<Dimension>(sums.values);
+			auto values = make_centroids<C>(num_clusters, data_size);
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				for (size_t d = 0; d < data_size; ++d)
+					values[k][d] = sums.counts[k] ? sums.values[k][d] / sums.counts[k] : previous[k][d]; // convert to average
+			}
+
+			return values;
+		}
+
+
+		// averages of the data clustered together, written over next
+		// a cluster without data keeps its previous centroid, returns the largest change of any centroid value
+		template<size_t Dimension, typename C>
+		double update_centroids(cluster_sums_t<C> const& sums, C const& previous, C& next)
+		{
+			const auto num_clusters = sums.counts.size();
+			const auto data_size = dimension<Dimension>(sums.values);
+
+			double max_shift = 0;
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				for (size_t d = 0; d < data_size; ++d)
+				{
+					next[k][d] = sums.counts[k] ? sums.values[k][d] / sums.counts[k] : previous[k][d]; // convert to average
+					max_shift = std::max(max_shift, std::abs(next[k][d] - previous[k][d]));
+				}
+			}
+
+			return max_shift;
+		}
+
+
+		inline bool has_empty_cluster(std::vector<unsigned> const& counts)
+		{
+			return std::find(counts.begin(), counts.end(), 0u) != counts.end();
+		}
+
+
+		// moves row i of a list to row map[i], copy is scratch space
+		template<typename C>
+		void reorder_rows(C& list, std::vector<size_t> const& map, C& copy)
+		{
+			const auto data_size = row_size(list);
+			copy = list;
+
+			for (size_t i = 0; i < map.size(); ++i)
+			{
+				for (size_t d = 0; d < data_size; ++d)
+					list[map[i]][d] = copy[i][d];
+			}
+		}
+
+
+		// re-label cluster assignments in order of first appearance so that results can be compared
+		// centroids and cluster totals are moved to match the new labels
+		template<typename Result, typename C>
+		void relabel_clusters(Result& result, cluster_sums_t<C>& sums, size_t num_clusters, ClusterBuffers<C>& buffers)
+		{
+			auto& flags = buffers.flags; // tracks if cluster index has been mapped
+			auto& map = buffers.map;     // maps old cluster index to new cluster index
+
+			flags.assign(num_clusters, 0);
+			map.assign(num_clusters, 0);
+
+			size_t i = 0;
+			size_t label = 0;
+
+			for (; label < num_clusters && i < result.x_clusters.size(); ++i)
+			{
+				size_t c = result.x_clusters[i];
+				if (flags[c])
+					continue;
+
+				map[c] = label;
+				flags[c] = 1;
+				++label;
+			}
+
+			// clusters without data take the remaining labels
+			for (size_t c = 0; c < num_clusters; ++c)
+			{
+				if (!flags[c])
+					map[c] = label++;
+			}
+
+			// re-label cluster assignments
+			for (i = 0; i < result.x_clusters.size(); ++i)
+			{
+				size_t c = result.x_clusters[i];
+				result.x_clusters[i] = map[c];
+			}
+
+			reorder_rows(result.centroids, map, buffers.copy);
+			reorder_rows(sums.values, map, buffers.copy);
+
+			buffers.counts = sums.counts;
+			for (size_t c = 0; c < num_clusters; ++c)
+				sums.counts[map[c]] = buffers.counts[c];
+		}
+
+
+		template<typename Result, typename C>
+		void relabel_clusters(Result& result, cluster_sums_t<C>& sums, size_t num_clusters)
+		{
+			ClusterBuffers<C> buffers;
+			relabel_clusters(result, sums, num_clusters, buffers);
+		}
+
+
+		//======= SEEDING ==========================
+
+		// copies a data row into a centroid
+		template<typename R, typename V, typename T>
+		void set_centroid(V&& centroid, R const& x_data, T const& converter, size_t data_size)
+		{
+			for (size_t d = 0; d < data_size; ++d)
+				centroid[d] = converter(x_data[d]);
+		}
+
+
+		// uniform random number in [0, 1) that only depends on the seed and the input
+		// data can then be sampled in any order and give the same result
+		inline double hash_uniform(uint64_t seed, uint64_t value)
+		{
+			return (mix_seed(seed ^ mix_seed(value)) >> 11) * 0x1.0p-53;
+		}
+
+
+		// random index chosen with probability proportional to its weight
+		// all weights zero chooses uniformly
+		template<typename G>
+		size_t sample_weighted(std::vector<double> const& weights, G& gen)
+		{
+			double total = 0;
+			for (auto const weight : weights)
+				total += weight;
+
+			if (!(total > 0))
+				return std::uniform_int_distribution<size_t>(0, weights.size() - 1)(gen);
+
+			auto target = std::uniform_real_distribution<double>(0, total)(gen);
+
+			size_t last = 0;
+			for (size_t i = 0; i < weights.size(); ++i)
+			{
+				if (weights[i] <= 0)
+					continue;
+
+				last = i;
+				target -= weights[i];
+				if (target < 0)
+					return i;
+			}
+
+			return last; // rounding
+		}
+
+
+		// lowers the distance of each row from its closest centroid given the centroids [first, last)
+		template<size_t Dimension, typename L, typename C, typename D>
+		void update_min_distances(L const& x_list, C const& centroids, size_t first, size_t last, D const& distance, std::vector<double>& min_distances, ThreadPool& pool)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+
+			for_each_range(pool, x_list.size(), [&](size_t, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					for (size_t k = first; k < last; ++k)
+						min_distances[i] = std::min(min_distances[i], distance(x_list[i], centroids[k], data_size));
+				}
+			});
+		}
+
+
+		// k-means++, "k-means++: The Advantages of Careful Seeding" (2007)
+		// each centroid is a row chosen with probability proportional to its distance from the centroids chosen so far
+		// only the given rows are candidates, each weighted by how much data it stands for
+		template<typename C, size_t Dimension, typename L, typename D, typename T>
+		C get_weighted_centroids(L const& x_list, index_list_t const& rows, std::vector<double> const& row_weights, size_t num_clusters, D const& distance, T const& converter, std::mt19937_64& gen)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+			auto centroids = make_centroids<C>(num_clusters, data_size);
+
+			std::vector<double> min_distances(rows.size(), std::numeric_limits<double>::max());
+			std::vector<double> weights = row_weights;
+
+			auto next = sample_weighted(weights, gen);
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				set_centroid(centroids[k], x_list[rows[next]], converter, data_size);
+
+				if (k + 1 == num_clusters)
+					break;
+
+				for (size_t j = 0; j < rows.size(); ++j)
+				{
+					min_distances[j] = std::min(min_distances[j], distance(x_list[rows[j]], centroids[k], data_size));
+					weights[j] = row_weights[j] * min_distances[j];
+				}
+
+				next = sample_weighted(weights, gen);
+			}
+
+			return centroids;
+		}
+
+
+		// k-means++ over all of the data, the distance updates are split over the pool
+		template<size_t Dimension, typename L, typename C, typename D, typename T>
+		void set_kmeans_pp_centroids(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, ThreadPool& pool, C& centroids, std::vector<double>& min_distances)
+		{
+			const auto data_size = dimension<Dimension>(x_list);
+			zero_centroids(centroids, num_clusters, data_size);
+
+			std::mt19937_64 gen{ seed };
+			min_distances.assign(x_list.size(), std::numeric_limits<double>::max());
+
+			auto next = std::uniform_int_distribution<size_t>(0, x_list.size() - 1)(gen);
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				set_centroid(centroids[k], x_list[next], converter, data_size);
+
+				if (k + 1 == num_clusters)
+					break;
+
+				update_min_distances<Dimension>(x_list, centroids, k, k + 1, distance, min_distances, pool);
+				next = sample_weighted(min_distances, gen);
+			}
+		}
+
+
+		template<typename C, size_t Dimension, typename L, typename D, typename T>
+		C get_kmeans_pp_centroids(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, ThreadPool& pool)
+		{
+			C centroids;
+			std::vector<double> min_distances;
+			set_kmeans_pp_centroids<Dimension>(x_list, num_clusters, distance, converter, seed, pool, centroids, min_distances);
+
+			return centroids;
+		}
+
+
+		// k-means||, "Scalable K-Means++" (2012)
+		// a few passes each sample about 2 * num_clusters rows at once, in proportion to their distance from the rows sampled so far
+		// the sampled rows are weighted by the data closest to them and reduced to num_clusters with k-means++
+		template<typename C, size_t Dimension, typename L, typename D, typename T>
+		C get_kmeans_parallel_centroids(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, ThreadPool& pool)
+		{
+			constexpr size_t num_rounds = 5;
+
+			const auto num_data = x_list.size();
+			const auto data_size = dimension<Dimension>(x_list);
+			const auto oversampling = 2.0 * num_clusters;
+
+			std::mt19937_64 gen{ seed };
+			std::vector<double> min_distances(num_data, std::numeric_limits<double>::max());
+
+			index_list_t candidates = { std::uniform_int_distribution<size_t>(0, num_data - 1)(gen) };
+			index_list_t added = candidates;
+
+			for (size_t round = 0; round <= num_rounds && !added.empty(); ++round)
+			{
+				auto round_centroids = make_centroids<C>(added.size(), data_size);
+				for (size_t j = 0; j < added.size(); ++j)
+					set_centroid(round_centroids[j], x_list[added[j]], converter, data_size);
+
+				update_min_distances<Dimension>(x_list, round_centroids, 0, added.size(), distance, min_distances, pool);
+
+				if (round == num_rounds)
+					break;
+
+				double total = 0;
+				for (auto const dist : min_distances)
+					total += dist;
+
+				added.clear();
+				for (size_t i = 0; i < num_data && total > 0; ++i)
+				{
+					if (hash_uniform(seed, round * num_data + i) * total < oversampling * min_distances[i])
+						added.push_back(i);
+				}
+
+				candidates.insert(candidates.end(), added.begin(), added.end());
+			}
+
+			if (candidates.size() <= num_clusters)
+				return get_kmeans_pp_centroids<C, Dimension>(x_list, num_clusters, distance, converter, seed, pool);
+
+			auto all = make_centroids<C>(candidates.size(), data_size);
+			for (size_t j = 0; j < candidates.size(); ++j)
+				set_centroid(all[j], x_list[candidates[j]], converter, data_size);
+
+			// weight of each candidate is the number of rows closest to it
+			const auto num_ranges = num_data_ranges(pool, num_data);
+			std::vector<std::vector<double>> range_weights(num_ranges, std::vector<double>(candidates.size(), 0));
+
+			for_each_range(pool, num_data, [&](size_t range, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					++range_weights[range][closest<Dimension>(distance, x_list[i], all).index];
+			});
+
+			auto weights = std::move(range_weights[0]);
+			for (size_t r = 1; r < num_ranges; ++r)
+			{
+				for (size_t j = 0; j < weights.size(); ++j)
+					weights[j] += range_weights[r][j];
+			}
+
+			return get_weighted_centroids<C, Dimension>(x_list, candidates, weights, num_clusters, distance, converter, gen);
+		}
+
+
+		// centroids to start clustering from
+		// random rows and k-means++ reuse the storage of centroids and min_distances, k-means|| allocates as it goes
+		template<size_t Dimension, typename L, typename C, typename D, typename T>
+		void set_initial_centroids(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool, C& centroids, std::vector<double>& min_distances)
+		{
+			if (seeding == seeding_t::kmeans_pp)
+				set_kmeans_pp_centroids<Dimension>(x_list, num_clusters, distance, converter, seed, pool, centroids, min_distances);
+			else if (seeding == seeding_t::kmeans_parallel)
+				centroids = get_kmeans_parallel_centroids<C, Dimension>(x_list, num_clusters, distance, converter, seed, pool);
+			else
+				set_random_centroids<Dimension>(x_list, num_clusters, converter, seed, centroids);
+		}
+
+
+		template<typename C, size_t Dimension, typename L, typename D, typename T>
+		C initial_centroids(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool)
+		{
+			C centroids;
+			std::vector<double> min_distances;
+			set_initial_centroids<Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool, centroids, min_distances);
+
+			return centroids;
+		}
+
+
+		//======= CLUSTERING ALGORITHMS ==========================
+
+
+		// returns the result with the smallest distance
+		// attempts are spread over the pool and each one is seeded from the master seed
+		// ties go to the earliest attempt so the result does not depend on the number of threads
+		template<typename L, typename F>
+		auto cluster_min_distance(L const& x_list, size_t num_clusters, F const& cluster_once, ThreadPool& pool, uint64_t seed, size_t num_attempts = CLUSTER_ATTEMPTS + 1)
+		{
+			using result_t = decltype(cluster_once(x_list, num_clusters, seed));
+
+			result_t min;
+			size_t min_attempt = num_attempts;
+			std::mutex min_mutex;
+
+			pool.run(num_attempts, [&](size_t attempt)
+			{
+				auto result = cluster_once(x_list, num_clusters, attempt_seed(seed, attempt));
+
+				std::lock_guard<std::mutex> lock(min_mutex);
+
+				const bool is_min = min_attempt == num_attempts
+					|| result.average_distance < min.average_distance
+					|| (result.average_distance == min.average_distance && attempt < min_attempt);
+
+				if (is_min)
+				{
+					min = std::move(result);
+					min_attempt = attempt;
+				}
+			});
+
+			return min;
+		}
+
+		// fingerprint of cluster labels, equal labels give equal hashes
+		inline uint64_t hash_labels(index_list_t const& x_clusters)
+		{
+			uint64_t hash = x_clusters.size();
+			for (auto const c : x_clusters)
+				hash = mix_seed(hash ^ c);
+
+			return hash;
+		}
+
+
+		// iterates until the cluster assignments stop changing or no centroid moves more than CLUSTER_TOLERANCE
+		// clusters are re-labelled once at the end
+		// the result is left in workspace, whose buffers are reused so that a workspace that has seen data of this size does not allocate
+		template<typename Result, size_t Dimension, typename L, typename D, typename T>
+		void cluster_once(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool, AttemptWorkspace<Result>& workspace, AttemptProgress progress = AttemptProgress())
+		{
+			auto& result = workspace.result;
+			auto& buffers = workspace.buffers;
+
+			const auto num_evaluations = static_cast<uint64_t>(x_list.size()) * num_clusters; // every assignment pass
+			auto stop = stop_t::iterations;
+
+			set_initial_centroids<Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool, result.centroids, buffers.min_distances);
+
+			result.x_clusters.assign(x_list.size(), num_clusters);
+			const auto first = assign_labels<Dimension>(x_list, result.centroids, distance, converter, pool, result.x_clusters, result.x_clusters, workspace.sums, buffers);
+			result.average_distance = first.total_distance / x_list.size();
+			progress.iteration(result.average_distance, first.changed, workspace.sums.counts, num_evaluations);
+
+			workspace.centroids_try = result.centroids;
+			workspace.x_clusters_try.resize(x_list.size());
+
+			for (size_t i = 0; i < CLUSTER_ITERATIONS; ++i)
+			{
+				if (update_centroids<Dimension>(workspace.sums, result.centroids, workspace.centroids_try) <= CLUSTER_TOLERANCE)
+				{
+					stop = stop_t::tolerance;
+					break;
+				}
+
+				const auto assignment = assign_labels<Dimension>(x_list, workspace.centroids_try, distance, converter, pool, result.x_clusters, workspace.x_clusters_try, workspace.sums_try, buffers);
+				progress.iteration(assignment.total_distance / x_list.size(), assignment.changed, workspace.sums_try.counts, num_evaluations);
+
+				if (has_empty_cluster(workspace.sums_try.counts)) // the same centroids would be found again
+				{
+					stop = stop_t::empty_cluster;
+					break;
+				}
+
+				std::swap(result.x_clusters, workspace.x_clusters_try);
+				std::swap(result.centroids, workspace.centroids_try);
+				std::swap(workspace.sums, workspace.sums_try);
+				result.average_distance = assignment.total_distance / x_list.size();
+
+				if (!assignment.changed)
+				{
+					stop = stop_t::unchanged;
+					break;
+				}
+			}
+
+			relabel_clusters(result, workspace.sums, num_clusters, buffers);
+			progress.finish(result.average_distance, stop);
+		}
+
+
+		template<typename Result, size_t Dimension, typename L, typename D, typename T>
+		Result cluster_once(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool)
+		{
+			AttemptWorkspace<Result> workspace;
+			cluster_once<Result, Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool, workspace);
+
+			return std::move(workspace.result);
+		}
+	}
+}
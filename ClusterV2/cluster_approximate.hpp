@@ -0,0 +1,277 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+
+#include <atomic>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+// approximate closest centroid search for very many clusters, an inverted file over the centroids
+// the centroids are themselves grouped with k-means, a row is compared with the centre of every group
+// and then only with the centroids of the closest few groups (the probes)
+// with about sqrt(k) groups each row costs about (1 + probes) * sqrt(k) distances instead of k
+namespace cluster
+{
+	namespace algorithms
+	{
+		//======= CENTROID GROUPS =======================
+
+		template<size_t Dimension>
+		class CentroidGroups
+		{
+		private:
+
+			approximate_t m_options;
+
+			value_matrix_t m_centers;         // average of the centroids in each group
+			value_matrix_t m_members;         // centroids in group order
+			index_list_t m_member_index;      // index in the centroids of each row of m_members
+			index_list_t m_group_begin;       // members of group g are rows [m_group_begin[g], m_group_begin[g + 1])
+
+			// grouping the centroids, kept for the next update
+			index_list_t m_labels;
+			value_matrix_t m_centers_try;
+			cluster_sums_t<value_matrix_t> m_sums;
+			ClusterBuffers<value_matrix_t> m_buffers;
+
+		public:
+
+			CentroidGroups(approximate_t const& options = approximate_t())
+				: m_options(options) {}
+
+			size_t num_groups() const { return m_centers.size(); }
+
+			size_t num_probes() const { return std::min(std::max(m_options.probes, size_t(1)), num_groups()); }
+
+			// groups the centroids, split over the pool
+			// the groups of the previous update are the starting point, so centroids that have moved a little are grouped quickly
+			template<typename D>
+			void update(value_view_t const& centroids, D const& distance, ThreadPool& pool);
+
+			// the closest centroid in the closest num_probes() groups, ties go to the lower centroid index
+			// scratch holds the distance of each group, the distances calculated are added to evaluations when given
+			template<typename D>
+			distance_result_t find(data_t const* data, D const& distance, std::vector<distance_result_t>& scratch, uint64_t* evaluations = nullptr) const;
+		};
+
+
+		template<size_t Dimension>
+		template<typename D>
+		void CentroidGroups<Dimension>::update(value_view_t const& centroids, D const& distance, ThreadPool& pool)
+		{
+			const auto num_clusters = centroids.size();
+			const auto data_size = centroids.dimension();
+
+			if (!num_clusters)
+				return;
+
+			const auto default_groups = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(num_clusters))));
+			const auto num_groups = std::min(std::max(m_options.groups ? m_options.groups : default_groups, size_t(1)), num_clusters);
+
+			// evenly spaced centroids start the groups
+			if (m_centers.size() != num_groups || m_centers.dimension() != data_size)
+			{
+				m_centers = value_matrix_t(num_groups, data_size);
+				for (size_t g = 0; g < num_groups; ++g)
+					std::copy(centroids[g * num_clusters / num_groups], centroids[g * num_clusters / num_groups] + data_size, m_centers[g]);
+			}
+
+			auto const identity = [](data_t value) { return value; };
+
+			m_labels.assign(num_clusters, num_groups);
+			m_centers_try = m_centers;
+
+			// each centre ends up as the average of the centroids in its group
+			for (size_t i = 0; i < std::max(m_options.iterations, size_t(1)); ++i)
+			{
+				assign_labels<Dimension>(centroids, m_centers, distance, identity, pool, m_labels, m_labels, m_sums, m_buffers);
+
+				const auto max_shift = update_centroids<Dimension>(m_sums, m_centers, m_centers_try);
+				std::swap(m_centers, m_centers_try);
+
+				if (max_shift == 0)
+					break;
+			}
+
+			// members are stored group by group in order of centroid index
+			m_group_begin.assign(num_groups + 1, 0);
+			for (auto const label : m_labels)
+				++m_group_begin[label + 1];
+
+			std::partial_sum(m_group_begin.begin(), m_group_begin.end(), m_group_begin.begin());
+
+			if (m_members.size() != num_clusters || m_members.dimension() != data_size)
+				m_members = value_matrix_t(num_clusters, data_size);
+
+			m_member_index.resize(num_clusters);
+
+			auto& next = m_buffers.map;
+			next.assign(m_group_begin.begin(), m_group_begin.end() - 1);
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				const auto row = next[m_labels[k]]++;
+
+				std::copy(centroids[k], centroids[k] + data_size, m_members[row]);
+				m_member_index[row] = k;
+			}
+		}
+
+
+		template<size_t Dimension>
+		template<typename D>
+		distance_result_t CentroidGroups<Dimension>::find(data_t const* data, D const& distance, std::vector<distance_result_t>& scratch, uint64_t* evaluations) const
+		{
+			const auto num_groups = m_centers.size();
+			const auto data_size = dimension<Dimension>(m_centers);
+			const auto probes = num_probes();
+
+			scratch.resize(num_groups);
+			for (size_t g = 0; g < num_groups; ++g)
+				scratch[g] = { g, distance(data, m_centers[g], data_size) };
+
+			if (probes < num_groups)
+			{
+				std::nth_element(scratch.begin(), scratch.begin() + probes, scratch.end(), [](distance_result_t const& lhs, distance_result_t const& rhs)
+				{
+					return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.index < rhs.index);
+				});
+			}
+
+			const auto num_clusters = m_member_index.size();
+			distance_result_t best = { num_clusters, std::numeric_limits<double>::max() };
+			auto searched = num_groups;
+
+			// groups past the probes are only searched when every probed group was empty
+			for (size_t p = 0; p < num_groups && (p < probes || best.index == num_clusters); ++p)
+			{
+				const auto g = scratch[p].index;
+				const auto begin = m_group_begin[g];
+				const auto end = m_group_begin[g + 1];
+
+				if (begin == end)
+					continue;
+
+				const value_view_t members(m_members[begin], end - begin, m_members.dimension(), m_members.stride());
+				const auto c = closest<Dimension>(distance, data, members);
+				const auto index = m_member_index[begin + c.index];
+				searched += end - begin;
+
+				if (c.distance < best.distance || (c.distance == best.distance && index < best.index))
+					best = { index, c.distance };
+			}
+
+			if (evaluations)
+				*evaluations += searched;
+
+			return best;
+		}
+
+
+		//======= APPROXIMATE ASSIGNMENT =======================
+
+		// distance policy that finds the closest centroid of each row through the centroid groups
+		// the groups must have been updated from the centroids that are passed to closest_rows
+		template<typename D, size_t Dimension>
+		class ApproximateDistance
+		{
+		private:
+
+			D const& m_distance;
+			data_view_t m_rows;
+			CentroidGroups<Dimension> const& m_groups;
+
+			mutable std::atomic<uint64_t> m_evaluations{ 0 }; // distances calculated by closest_rows, added once per range
+
+		public:
+
+			ApproximateDistance(D const& distance, data_view_t const& x_list, CentroidGroups<Dimension> const& groups)
+				: m_distance(distance), m_rows(x_list), m_groups(groups) {}
+
+			template<typename R, typename C>
+			double operator()(R const& data, C const& centroid, size_t size) const
+			{
+				return m_distance(data, centroid, size);
+			}
+
+			bool covers(data_view_t const& x_list) const
+			{
+				return x_list.data() == m_rows.data() && x_list.size() == m_rows.size() && x_list.stride() == m_rows.stride();
+			}
+
+			// closest centroid of rows [begin, end)
+			void closest_rows(size_t begin, size_t end, value_view_t const&, size_t* indexes, double* distances) const
+			{
+				std::vector<distance_result_t> scratch;
+				uint64_t evaluations = 0;
+
+				for (size_t i = begin; i < end; ++i)
+				{
+					const auto c = m_groups.find(m_rows[i], m_distance, scratch, &evaluations);
+					indexes[i - begin] = c.index;
+					distances[i - begin] = c.distance;
+				}
+
+				m_evaluations.fetch_add(evaluations, std::memory_order_relaxed);
+			}
+
+			// distances calculated since the last call
+			uint64_t take_evaluations() const { return m_evaluations.exchange(0, std::memory_order_relaxed); }
+		};
+
+
+		// lloyd iterations with every row assigned through centroid groups that are updated after each centroid step
+		// with many clusters some are usually empty, they keep their centroid and iterating carries on
+		template<typename Result, size_t Dimension, typename D, typename T>
+		void cluster_once_approximate(data_view_t const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, approximate_t const& options, ThreadPool& pool, AttemptWorkspace<Result>& workspace, AttemptProgress progress = AttemptProgress())
+		{
+			auto& result = workspace.result;
+			auto& buffers = workspace.buffers;
+
+			set_initial_centroids<Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool, result.centroids, buffers.min_distances);
+
+			CentroidGroups<Dimension> groups(options);
+			const ApproximateDistance<D, Dimension> approximate(distance, x_list, groups);
+
+			groups.update(result.centroids, distance, pool);
+
+			result.x_clusters.assign(x_list.size(), num_clusters);
+			const auto first = assign_labels<Dimension>(x_list, result.centroids, approximate, converter, pool, result.x_clusters, result.x_clusters, workspace.sums, buffers);
+			result.average_distance = first.total_distance / x_list.size();
+			progress.iteration(result.average_distance, first.changed, workspace.sums.counts, approximate.take_evaluations());
+
+			workspace.centroids_try = result.centroids;
+			workspace.x_clusters_try.resize(x_list.size());
+			auto stop = stop_t::iterations;
+
+			for (size_t i = 0; i < CLUSTER_ITERATIONS; ++i)
+			{
+				if (update_centroids<Dimension>(workspace.sums, result.centroids, workspace.centroids_try) <= CLUSTER_TOLERANCE)
+				{
+					stop = stop_t::tolerance;
+					break;
+				}
+
+				groups.update(workspace.centroids_try, distance, pool);
+
+				const auto assignment = assign_labels<Dimension>(x_list, workspace.centroids_try, approximate, converter, pool, result.x_clusters, workspace.x_clusters_try, workspace.sums_try, buffers);
+
+				std::swap(result.x_clusters, workspace.x_clusters_try);
+				std::swap(result.centroids, workspace.centroids_try);
+				std::swap(workspace.sums, workspace.sums_try);
+				result.average_distance = assignment.total_distance / x_list.size();
+				progress.iteration(result.average_distance, assignment.changed, workspace.sums.counts, approximate.take_evaluations());
+
+				if (!assignment.changed)
+				{
+					stop = stop_t::unchanged;
+					break;
+				}
+			}
+
+			relabel_clusters(result, workspace.sums, num_clusters, buffers);
+			progress.finish(result.average_distance, stop);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+#include "distance.hpp"
+
+#include <type_traits>
+
+// squared euclidean assignment of many rows at once as |x|^2 - 2 x.c + |c|^2
+// the dot products are blocked so rows and centroids are reused from cache, which pays off for wide rows
+namespace cluster
+{
+	namespace algorithms
+	{
+		// a distance policy can say which built-in metric it calculates
+		// metric_t metric() const;
+		template<typename D, typename = void>
+		struct has_metric_type : std::false_type {};
+
+		template<typename D>
+		struct has_metric_type<D, std::void_t<decltype(std::declval<D const&>().metric())>> : std::true_type {};
+
+
+		// blocked assignment is used for squared euclidean rows of at least CLUSTER_BLOCKED_MIN_DIMENSION values
+		template<typename D>
+		bool use_blocked(D const& distance, size_t data_size)
+		{
+			if constexpr (has_metric_type<D>::value && has_metric<D>::value)
+				return distance.metric() == metric_t::squared_euclidean && data_size >= CLUSTER_BLOCKED_MIN_DIMENSION;
+			else
+				return false;
+		}
+
+
+		// squared euclidean distance for a list of rows, the norm of each row is calculated once
+		// and used by every iteration and attempt
+		// the norms are kept in storage owned by the caller so that it can be reused
+		template<typename D>
+		class BlockedDistance
+		{
+		private:
+
+			D const& m_distance;
+			data_view_t m_rows;
+			std::vector<double>& m_norms;
+
+		public:
+
+			BlockedDistance(D const& distance, data_view_t const& x_list, ThreadPool& pool, std::vector<double>& norms)
+				: m_distance(distance), m_rows(x_list), m_norms(norms)
+			{
+				m_norms.resize(x_list.size());
+
+				for_each_range(pool, x_list.size(), [&](size_t, size_t begin, size_t end)
+				{
+					squared_norms(x_list[begin], end - begin, x_list.stride(), x_list.dimension(), m_norms.data() + begin);
+				});
+			}
+
+			bool is_metric() const { return m_distance.is_metric(); }
+
+			double to_metric(double distance) const { return m_distance.to_metric(distance); }
+
+			template<typename R, typename C>
+			double operator()(R const& data, C const& centroid, size_t size) const
+			{
+				return m_distance(data, centroid, size);
+			}
+
+			distance_result_t closest(data_t const* data, value_view_t const& centroids) const
+			{
+				return algorithms::closest<dynamic_dimension>(m_distance, data, centroids);
+			}
+
+			// the norms were calculated for these rows
+			bool covers(data_view_t const& x_list) const
+			{
+				return x_list.data() == m_rows.data() && x_list.size() == m_rows.size() && x_list.stride() == m_rows.stride();
+			}
+
+			// closest centroid of rows [begin, end)
+			void closest_rows(size_t begin, size_t end, value_view_t const& centroids, size_t* indexes, double* distances) const
+			{
+				closest_squared_euclidean(m_rows[begin], end - begin, m_rows.stride(), m_norms.data() + begin,
+					centroids.data(), centroids.size(), centroids.stride(), m_rows.dimension(), indexes, distances);
+			}
+		};
+	}
+}
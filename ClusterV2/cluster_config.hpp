@@ -1,6 +1,6 @@
 #pragma once
 
-#include "cluster.hpp"
+#include <cstddef>
 
 namespace cluster
 {	
@@ -8,5 +8,18 @@ namespace cluster
 	//======= CONSTANTS ========================
 
 	constexpr size_t CLUSTER_ATTEMPTS = 50;
-	constexpr size_t CLUSTER_ITERATIONS = 30;	
-}
\ No newline at end of file
+	constexpr size_t CLUSTER_ITERATIONS = 30;
+	constexpr double CLUSTER_TOLERANCE = 0; // stops iterating once no centroid value moves more than this
+
+	// algorithm_t::automatic picks hamerly over elkan for rows smaller than this
+	// or when elkan would keep more than this many bounds (rows * clusters)
+	constexpr size_t CLUSTER_ELKAN_MIN_DIMENSION = 32;
+	constexpr size_t CLUSTER_ELKAN_MAX_BOUNDS = size_t(1) << 25;
+
+	// squared euclidean rows with at least this many values are assigned with blocked dot products
+	constexpr size_t CLUSTER_BLOCKED_MIN_DIMENSION = 64;
+
+	// CentroidIndex searches a k-d tree for rows of at most this many values when there are at least this many centroids
+	constexpr size_t CLUSTER_INDEX_MAX_TREE_DIMENSION = 8;
+	constexpr size_t CLUSTER_INDEX_MIN_TREE_CLUSTERS = 32;
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+
+#include <cstdint>
+#include <limits>
+
+// Elkan's algorithm, "Using the Triangle Inequality to Accelerate k-Means" (2003)
+// gives the same clusters as cluster_once but skips most distance calculations once centroids stop moving
+// memory: one upper bound per row and one lower bound per row and centroid
+namespace cluster
+{
+	namespace algorithms
+	{
+		// changes to the cluster totals when rows move between clusters
+		template<typename C>
+		struct ClusterMoves
+		{
+			C values;
+			std::vector<int64_t> counts;
+		};
+
+
+		// clears the changes of a range for the next iteration, keeping the storage
+		template<typename C>
+		void zero_moves(ClusterMoves<C>& moves, size_t num_clusters, size_t data_size)
+		{
+			zero_centroids(moves.values, num_clusters, data_size);
+			std::fill(moves.counts.begin(), moves.counts.end(), 0);
+		}
+
+
+		// records a row leaving one cluster for another
+		template<typename C, typename R, typename T>
+		void move_row(ClusterMoves<C>& moves, R const& x_data, size_t from, size_t to, T const& converter, size_t data_size)
+		{
+			--moves.counts[from];
+			++moves.counts[to];
+			for (size_t d = 0; d < data_size; ++d)
+			{
+				const auto value = converter(x_data[d]);
+				moves.values[from][d] -= value;
+				moves.values[to][d] += value;
+			}
+		}
+
+
+		// adds the changes of each range to the cluster totals
+		template<size_t Dimension, typename C>
+		void apply_moves(cluster_sums_t<C>& sums, std::vector<ClusterMoves<C>> const& moves)
+		{
+			const auto num_clusters = sums.counts.size();
+			const auto data_size = dimension<Dimension>(sums.values);
+
+			for (auto const& range_moves : moves)
+			{
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					sums.counts[k] = static_cast<unsigned>(sums.counts[k] + range_moves.counts[k]);
+
+					for (size_t d = 0; d < data_size; ++d)
+						sums.values[k][d] += range_moves.values[k][d];
+				}
+			}
+		}
+
+
+		// distance between every pair of centroids and half the distance of each centroid to its nearest other centroid
+		template<size_t Dimension, typename C, typename M>
+		void centroid_separation(C const& centroids, M const& metric, std::vector<double>& pair_distances, std::vector<double>& half_nearest)
+		{
+			const auto num_clusters = centroids.size();
+
+			for (size_t a = 0; a < num_clusters; ++a)
+			{
+				pair_distances[a * num_clusters + a] = 0;
+
+				for (size_t b = a + 1; b < num_clusters; ++b)
+				{
+					const auto dist = metric(centroids[a], centroids[b]);
+					pair_distances[a * num_clusters + b] = dist;
+					pair_distances[b * num_clusters + a] = dist;
+				}
+			}
+
+			for (size_t a = 0; a < num_clusters; ++a)
+			{
+				auto nearest = std::numeric_limits<double>::max();
+				for (size_t b = 0; b < num_clusters; ++b)
+				{
+					if (b != a)
+						nearest = std::min(nearest, pair_distances[a * num_clusters + b]);
+				}
+
+				half_nearest[a] = 0.5 * nearest;
+			}
+		}
+
+
+		template<typename Result, size_t Dimension, typename L, typename D, typename T>
+		Result cluster_once_elkan(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool, AttemptProgress progress = AttemptProgress())
+		{
+			using C = decltype(Result::centroids);
+
+			const auto num_data = x_list.size();
+			const auto data_size = dimension<Dimension>(x_list);
+			const auto num_ranges = num_data_ranges(pool, num_data);
+
+			auto const metric = [&](auto const& lhs, auto const& rhs) { return distance.to_metric(distance(lhs, rhs, data_size)); };
+
+			auto centroids = initial_centroids<C, Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool);
+
+			index_list_t x_clusters(num_data);
+			std::vector<double> upper(num_data);                // distance of each row from its centroid is at most this
+			std::vector<double> lower(num_data * num_clusters); // distance of each row from each centroid is at least this
+
+			// the first assignment calculates every distance
+			for_each_range(pool, num_data, [&](size_t, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					auto const row_lower = lower.data() + i * num_clusters;
+
+					size_t best = 0;
+					for (size_t k = 0; k < num_clusters; ++k)
+					{
+						row_lower[k] = metric(x_list[i], centroids[k]);
+						if (row_lower[k] < row_lower[best])
+							best = k;
+					}
+
+					x_clusters[i] = best;
+					upper[i] = row_lower[best];
+				}
+			});
+
+			auto sums = total_clusters<Dimension, C>(x_list, x_clusters, num_clusters, converter, pool);
+
+			// the bounds only give the exact distance of the rows when the observer asks for it
+			auto const observed_distance = [&]() { return progress.is_on() ? average_distance<Dimension>(x_list, x_clusters, centroids, distance, pool) : 0.0; };
+			progress.iteration(observed_distance(), num_data, sums.counts, static_cast<uint64_t>(num_data) * num_clusters);
+
+			std::vector<double> shift(num_clusters);
+			std::vector<double> pair_distances(num_clusters * num_clusters);
+			std::vector<double> half_nearest(num_clusters);
+			std::vector<size_t> changed(num_ranges);
+			std::vector<uint64_t> evaluations(num_ranges);
+			std::vector<ClusterMoves<C>> moves(num_ranges, { make_centroids<C>(num_clusters, data_size), std::vector<int64_t>(num_clusters, 0) });
+			auto stop = stop_t::iterations;
+
+			for (size_t iteration = 0; iteration < CLUSTER_ITERATIONS; ++iteration)
+			{
+				auto next = calc_centroids<Dimension>(sums, centroids);
+
+				bool moved = false;
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					shift[k] = metric(next[k], centroids[k]);
+					moved = moved || shift[k] > 0;
+				}
+
+				if (!moved)
+				{
+					stop = stop_t::tolerance;
+					break;
+				}
+
+				centroids = std::move(next);
+				centroid_separation<Dimension>(centroids, metric, pair_distances, half_nearest);
+
+				for_each_range(pool, num_data, [&](size_t range, size_t begin, size_t end)
+				{
+					auto& range_moves = moves[range];
+					zero_moves(range_moves, num_clusters, data_size);
+					changed[range] = 0;
+					uint64_t range_evaluations = 0;
+
+					for (size_t i = begin; i < end; ++i)
+					{
+						auto const& x_data = x_list[i];
+						auto const row_lower = lower.data() + i * num_clusters;
+
+						// bounds follow the centroids
+						for (size_t k = 0; k < num_clusters; ++k)
+							row_lower[k] = std::max(row_lower[k] - shift[k], 0.0);
+
+						const auto old_c = x_clusters[i];
+						auto c = old_c;
+						auto u = upper[i] + shift[c];
+
+						if (u > half_nearest[c])
+						{
+							bool is_exact = false;
+
+							for (size_t k = 0; k < num_clusters; ++k)
+							{
+								if (k == c || u <= row_lower[k] || u <= 0.5 * pair_distances[c * num_clusters + k])
+									continue;
+
+								if (!is_exact)
+								{
+									u = metric(x_data, centroids[c]);
+									row_lower[c] = u;
+									is_exact = true;
+									++range_evaluations;
+
+									if (u <= row_lower[k] || u <= 0.5 * pair_distances[c * num_clusters + k])
+										continue;
+								}
+
+								const auto dist = metric(x_data, centroids[k]);
+								row_lower[k] = dist;
+								++range_evaluations;
+
+								if (dist < u)
+								{
+									u = dist;
+									c = k;
+								}
+							}
+						}
+
+						upper[i] = u;
+
+						if (c == old_c)
+							continue;
+
+						x_clusters[i] = c;
+						++changed[range];
+
+						move_row(range_moves, x_data, old_c, c, converter, data_size);
+					}
+
+					evaluations[range] = range_evaluations;
+				});
+
+				apply_moves<Dimension>(sums, moves);
+
+				size_t total_changed = 0;
+				for (auto const count : changed)
+					total_changed += count;
+
+				uint64_t total_evaluations = 0;
+				for (auto const count : evaluations)
+					total_evaluations += count;
+
+				progress.iteration(observed_distance(), total_changed, sums.counts, total_evaluations);
+
+				if (total_changed == 0)
+				{
+					stop = stop_t::unchanged;
+					break;
+				}
+			}
+
+			const auto avg = average_distance<Dimension>(x_list, x_clusters, centroids, distance, pool);
+
+			Result result = { std::move(x_clusters), std::move(centroids), avg };
+			relabel_clusters(result, sums, num_clusters);
+			progress.finish(avg, stop);
+
+			return result;
+		}
+	}
+}
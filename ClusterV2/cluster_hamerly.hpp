@@ -0,0 +1,209 @@
+#pragma once
+
+#include "cluster_elkan.hpp"
+
+#include <cstdint>
+#include <limits>
+
+// Hamerly's algorithm, "Making k-means even faster" (2010)
+// gives the same clusters as cluster_once, like Elkan's algorithm but with a single lower bound per row
+// memory: one upper and one lower bound per row, suits large data with many clusters
+namespace cluster
+{
+	namespace algorithms
+	{
+		// the closest and second closest centroid of a row
+		template<typename R, typename C, typename M>
+		void closest_two(R const& x_data, C const& centroids, M const& metric, size_t& best, double& best_dist, double& second_dist)
+		{
+			best = 0;
+			best_dist = std::numeric_limits<double>::max();
+			second_dist = std::numeric_limits<double>::max();
+
+			for (size_t k = 0; k < centroids.size(); ++k)
+			{
+				const auto dist = metric(x_data, centroids[k]);
+
+				if (dist < best_dist)
+				{
+					second_dist = best_dist;
+					best_dist = dist;
+					best = k;
+				}
+				else if (dist < second_dist)
+					second_dist = dist;
+			}
+		}
+
+
+		// half the distance of each centroid to its nearest other centroid, without keeping the distance of every pair
+		template<size_t Dimension, typename C, typename M>
+		void nearest_separation(C const& centroids, M const& metric, std::vector<double>& half_nearest)
+		{
+			const auto num_clusters = centroids.size();
+			std::fill(half_nearest.begin(), half_nearest.end(), std::numeric_limits<double>::max());
+
+			for (size_t a = 0; a < num_clusters; ++a)
+			{
+				for (size_t b = a + 1; b < num_clusters; ++b)
+				{
+					const auto dist = metric(centroids[a], centroids[b]);
+					half_nearest[a] = std::min(half_nearest[a], dist);
+					half_nearest[b] = std::min(half_nearest[b], dist);
+				}
+
+				half_nearest[a] *= 0.5;
+			}
+		}
+
+
+		// bound based algorithm to use when the choice is automatic
+		// elkan skips the most distance calculations but keeps num_data * num_clusters bounds
+		// and only pays off when each distance is expensive
+		inline algorithm_t select_algorithm(size_t num_data, size_t num_clusters, size_t data_size)
+		{
+			if (data_size < CLUSTER_ELKAN_MIN_DIMENSION || num_data * num_clusters > CLUSTER_ELKAN_MAX_BOUNDS)
+				return algorithm_t::hamerly;
+
+			return algorithm_t::elkan;
+		}
+
+
+		template<typename Result, size_t Dimension, typename L, typename D, typename T>
+		Result cluster_once_hamerly(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, ThreadPool& pool, AttemptProgress progress = AttemptProgress())
+		{
+			using C = decltype(Result::centroids);
+
+			const auto num_data = x_list.size();
+			const auto data_size = dimension<Dimension>(x_list);
+			const auto num_ranges = num_data_ranges(pool, num_data);
+
+			auto const metric = [&](auto const& lhs, auto const& rhs) { return distance.to_metric(distance(lhs, rhs, data_size)); };
+
+			auto centroids = initial_centroids<C, Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool);
+
+			index_list_t x_clusters(num_data);
+			std::vector<double> upper(num_data); // distance of each row from its centroid is at most this
+			std::vector<double> lower(num_data); // distance of each row from every other centroid is at least this
+
+			// the first assignment calculates every distance
+			for_each_range(pool, num_data, [&](size_t, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					closest_two(x_list[i], centroids, metric, x_clusters[i], upper[i], lower[i]);
+			});
+
+			auto sums = total_clusters<Dimension, C>(x_list, x_clusters, num_clusters, converter, pool);
+
+			// the bounds only give the exact distance of the rows when the observer asks for it
+			auto const observed_distance = [&]() { return progress.is_on() ? average_distance<Dimension>(x_list, x_clusters, centroids, distance, pool) : 0.0; };
+			progress.iteration(observed_distance(), num_data, sums.counts, static_cast<uint64_t>(num_data) * num_clusters);
+
+			std::vector<double> shift(num_clusters);
+			std::vector<double> half_nearest(num_clusters);
+			std::vector<size_t> changed(num_ranges);
+			std::vector<uint64_t> evaluations(num_ranges);
+			std::vector<ClusterMoves<C>> moves(num_ranges, { make_centroids<C>(num_clusters, data_size), std::vector<int64_t>(num_clusters, 0) });
+			auto stop = stop_t::iterations;
+
+			for (size_t iteration = 0; iteration < CLUSTER_ITERATIONS; ++iteration)
+			{
+				auto next = calc_centroids<Dimension>(sums, centroids);
+
+				// the largest shift lowers the bound of every row, except rows of that cluster use the second largest
+				size_t max_k = 0;
+				double max_shift = 0;
+				double second_shift = 0;
+
+				for (size_t k = 0; k < num_clusters; ++k)
+				{
+					shift[k] = metric(next[k], centroids[k]);
+
+					if (shift[k] > max_shift)
+					{
+						second_shift = max_shift;
+						max_shift = shift[k];
+						max_k = k;
+					}
+					else if (shift[k] > second_shift)
+						second_shift = shift[k];
+				}
+
+				if (max_shift == 0)
+				{
+					stop = stop_t::tolerance;
+					break;
+				}
+
+				centroids = std::move(next);
+				nearest_separation<Dimension>(centroids, metric, half_nearest);
+
+				for_each_range(pool, num_data, [&](size_t range, size_t begin, size_t end)
+				{
+					auto& range_moves = moves[range];
+					zero_moves(range_moves, num_clusters, data_size);
+					changed[range] = 0;
+					uint64_t range_evaluations = 0;
+
+					for (size_t i = begin; i < end; ++i)
+					{
+						auto const& x_data = x_list[i];
+						const auto old_c = x_clusters[i];
+
+						upper[i] += shift[old_c];
+						lower[i] -= old_c == max_k ? second_shift : max_shift;
+
+						const auto bound = std::max(half_nearest[old_c], lower[i]);
+						if (upper[i] <= bound)
+							continue;
+
+						upper[i] = metric(x_data, centroids[old_c]);
+						++range_evaluations;
+						if (upper[i] <= bound)
+							continue;
+
+						auto c = old_c;
+						closest_two(x_data, centroids, metric, c, upper[i], lower[i]);
+						range_evaluations += num_clusters;
+
+						if (c == old_c)
+							continue;
+
+						x_clusters[i] = c;
+						++changed[range];
+
+						move_row(range_moves, x_data, old_c, c, converter, data_size);
+					}
+
+					evaluations[range] = range_evaluations;
+				});
+
+				apply_moves<Dimension>(sums, moves);
+
+				size_t total_changed = 0;
+				for (auto const count : changed)
+					total_changed += count;
+
+				uint64_t total_evaluations = 0;
+				for (auto const count : evaluations)
+					total_evaluations += count;
+
+				progress.iteration(observed_distance(), total_changed, sums.counts, total_evaluations);
+
+				if (total_changed == 0)
+				{
+					stop = stop_t::unchanged;
+					break;
+				}
+			}
+
+			const auto avg = average_distance<Dimension>(x_list, x_clusters, centroids, distance, pool);
+
+			Result result = { std::move(x_clusters), std::move(centroids), avg };
+			relabel_clusters(result, sums, num_clusters);
+			progress.finish(avg, stop);
+
+			return result;
+		}
+	}
+}
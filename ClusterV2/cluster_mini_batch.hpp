@@ -0,0 +1,180 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// mini-batch k-means, "Web-Scale K-Means Clustering" (2010)
+// each step moves the centroids towards a small random batch of rows instead of visiting all of the data
+// trades a little quality for much less work on very large data
+namespace cluster
+{
+	namespace algorithms
+	{
+		// assigns each row of a batch to its closest centroid and totals the rows of each cluster, split over the pool
+		// batch_row(b) gives row b of the batch, returns the total distance of the rows from their centroids
+		template<size_t Dimension, typename B, typename C, typename D, typename T>
+		double total_batch(B const& batch_row, size_t batch_size, C const& centroids, D const& distance, T const& converter, ThreadPool& pool, std::vector<cluster_sums_t<C>>& range_sums)
+		{
+			const auto num_clusters = centroids.size();
+			const auto data_size = dimension<Dimension>(centroids);
+			const auto num_ranges = num_data_ranges(pool, batch_size);
+
+			std::vector<double> totals(num_ranges, 0);
+			range_sums.resize(num_ranges);
+
+			for_each_range(pool, batch_size, [&](size_t range, size_t begin, size_t end)
+			{
+				auto& sums = range_sums[range];
+				sums = { make_centroids<C>(num_clusters, data_size), std::vector<unsigned>(num_clusters, 0) };
+
+				double total = 0;
+				for (size_t b = begin; b < end; ++b)
+				{
+					auto const& x_data = batch_row(b);
+					auto c = closest<Dimension>(distance, x_data, centroids);
+
+					total += c.distance;
+
+					++sums.counts[c.index];
+					for (size_t d = 0; d < data_size; ++d)
+						sums.values[c.index][d] += converter(x_data[d]);
+				}
+
+				totals[range] = total;
+			});
+
+			double total_distance = 0;
+			for (auto const total : totals)
+				total_distance += total;
+
+			return total_distance;
+		}
+
+
+		// each centroid moves towards the average of its batch rows, less so the more rows it has seen
+		// seen holds the rows each centroid has learned from, returns the largest change of any centroid value
+		template<size_t Dimension, typename C>
+		double learn_batch(C& centroids, std::vector<double>& seen, std::vector<cluster_sums_t<C>> const& range_sums)
+		{
+			const auto num_clusters = centroids.size();
+			const auto data_size = dimension<Dimension>(centroids);
+
+			double max_shift = 0;
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				unsigned count = 0;
+				for (auto const& sums : range_sums)
+					count += sums.counts[k];
+
+				if (!count)
+					continue;
+
+				seen[k] += count;
+				const auto rate = 1.0 / seen[k];
+
+				for (size_t d = 0; d < data_size; ++d)
+				{
+					double total = 0;
+					for (auto const& sums : range_sums)
+						total += sums.values[k][d];
+
+					const auto step_size = rate * (total - count * centroids[k][d]);
+					centroids[k][d] += step_size;
+					max_shift = std::max(max_shift, std::abs(step_size));
+				}
+			}
+
+			return max_shift;
+		}
+
+
+		template<typename Result, size_t Dimension, typename L, typename D, typename T>
+		Result cluster_once_mini_batch(L const& x_list, size_t num_clusters, D const& distance, T const& converter, uint64_t seed, seeding_t seeding, mini_batch_t const& options, ThreadPool& pool, AttemptProgress progress = AttemptProgress())
+		{
+			using C = decltype(Result::centroids);
+
+			const auto num_data = x_list.size();
+			const auto batch_size = std::max(std::min(options.batch_size, num_data), size_t(1));
+
+			auto centroids = initial_centroids<C, Dimension>(x_list, num_clusters, distance, converter, seed, seeding, pool);
+
+			std::mt19937_64 gen{ mix_seed(seed) }; // independent of the stream used for seeding
+			std::uniform_int_distribution<size_t> pick(0, num_data - 1);
+
+			index_list_t batch(batch_size);
+			std::vector<cluster_sums_t<C>> range_sums;
+			std::vector<double> seen(num_clusters, 0);
+
+			auto const batch_row = [&](size_t b) -> decltype(auto) { return x_list[batch[b]]; };
+
+			// smoothed average distance of the batches, stops when it no longer improves
+			const auto alpha = std::min(2.0 * batch_size / (num_data + 1), 1.0);
+			auto smooth_distance = std::numeric_limits<double>::max();
+			auto best_distance = std::numeric_limits<double>::max();
+			size_t no_improvement = 0;
+
+			const auto batch_evaluations = static_cast<uint64_t>(batch_size) * num_clusters;
+			std::vector<unsigned> batch_counts; // rows of the batch in each cluster, only for the observer
+			auto stop = stop_t::iterations;
+
+			for (size_t step = 0; step < options.max_batches; ++step)
+			{
+				for (auto& i : batch)
+					i = pick(gen);
+
+				const auto batch_distance = total_batch<Dimension>(batch_row, batch_size, centroids, distance, converter, pool, range_sums) / batch_size;
+				const auto max_shift = learn_batch<Dimension>(centroids, seen, range_sums);
+
+				if (progress.is_on())
+				{
+					batch_counts.assign(num_clusters, 0);
+					for (auto const& sums : range_sums)
+					{
+						for (size_t k = 0; k < num_clusters; ++k)
+							batch_counts[k] += sums.counts[k];
+					}
+				}
+
+				progress.iteration(batch_distance, 0, batch_counts, batch_evaluations);
+
+				smooth_distance = step ? (1 - alpha) * smooth_distance + alpha * batch_distance : batch_distance;
+
+				if (smooth_distance < best_distance)
+				{
+					best_distance = smooth_distance;
+					no_improvement = 0;
+				}
+				else if (++no_improvement >= options.max_no_improvement)
+				{
+					stop = stop_t::no_improvement;
+					break;
+				}
+
+				if (max_shift <= options.tolerance)
+				{
+					stop = stop_t::tolerance;
+					break;
+				}
+			}
+
+			if (!options.assign_all)
+			{
+				Result result = { index_list_t(), std::move(centroids), best_distance };
+				progress.finish(best_distance, stop);
+				return result;
+			}
+
+			// the final assignment of every row is reported as one more iteration
+			cluster_sums_t<C> sums;
+			auto result = assign_clusters<Result, Dimension>(x_list, centroids, distance, converter, pool, sums);
+			progress.iteration(result.average_distance, 0, sums.counts, static_cast<uint64_t>(num_data) * num_clusters);
+			relabel_clusters(result, sums, num_clusters);
+			progress.finish(result.average_distance, stop);
+
+			return result;
+		}
+	}
+}
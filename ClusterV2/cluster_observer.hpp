@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// progress of clustering reported while it runs, for tuning attempts and iterations on real data
+// without an observer the engines only test a null pointer once per iteration
+namespace cluster
+{
+	//======= TYPE DEFINITIONS ====================
+
+	enum class stop_t
+	{
+		unchanged,     // no row moved to another cluster
+		tolerance,     // no centroid value moved more than CLUSTER_TOLERANCE (mini_batch: its own tolerance)
+		iterations,    // CLUSTER_ITERATIONS reached (mini_batch: max_batches)
+		empty_cluster, // lloyd stops when a cluster loses all of its rows, the same centroids would be found again
+		no_improvement // mini_batch, the smoothed batch distance stopped falling
+	};
+
+
+	typedef struct IterationEvent
+	{
+		size_t attempt;
+		size_t iteration;              // 0 is the assignment to the starting centroids
+		double average_distance;       // of the rows from their centroids, mini_batch: of the batch
+		size_t changed;                // rows that moved to another cluster, 0 for mini_batch
+		size_t empty_clusters;         // clusters without rows, mini_batch: without rows in the batch
+		uint64_t distance_evaluations; // row to centroid distances calculated in this iteration
+		double seconds;                // since the attempt started, including seeding
+
+	} iteration_event_t;
+
+
+	typedef struct AttemptEvent
+	{
+		size_t attempt;
+		size_t iterations;             // events reported for the attempt
+		double average_distance;       // of the result of the attempt
+		stop_t stop;
+		uint64_t distance_evaluations; // over all iterations
+		double seconds;
+
+	} attempt_event_t;
+
+
+	//======= CLASS DEFINITION =======================
+
+	// attempts running in parallel call the observer from their own threads at the same time
+	class ClusterObserver
+	{
+	public:
+
+		virtual ~ClusterObserver() = default;
+
+		virtual void on_iteration(iteration_event_t const&) {}
+
+		virtual void on_attempt(attempt_event_t const&) {}
+	};
+
+
+	namespace algorithms
+	{
+		// reports one attempt to an observer, does nothing when there is none
+		class AttemptProgress
+		{
+		private:
+
+			using clock_t = std::chrono::steady_clock;
+
+			ClusterObserver* m_observer = nullptr;
+			size_t m_attempt = 0;
+			clock_t::time_point m_start;
+
+			size_t m_iterations = 0;
+			uint64_t m_evaluations = 0;
+
+			double seconds() const { return std::chrono::duration<double>(clock_t::now() - m_start).count(); }
+
+		public:
+
+			AttemptProgress() = default;
+
+			AttemptProgress(ClusterObserver* observer, size_t attempt)
+				: m_observer(observer), m_attempt(attempt)
+			{
+				if (m_observer)
+					m_start = clock_t::now();
+			}
+
+			// the engines skip work that is only done for the observer, e.g. the exact distance of elkan and hamerly
+			bool is_on() const { return m_observer != nullptr; }
+
+			void iteration(double average_distance, size_t changed, std::vector<unsigned> const& counts, uint64_t evaluations)
+			{
+				if (!m_observer)
+					return;
+
+				const auto empty = static_cast<size_t>(std::count(counts.begin(), counts.end(), 0u));
+				m_evaluations += evaluations;
+
+				m_observer->on_iteration({ m_attempt, m_iterations++, average_distance, changed, empty, evaluations, seconds() });
+			}
+
+			void finish(double average_distance, stop_t stop)
+			{
+				if (!m_observer)
+					return;
+
+				m_observer->on_attempt({ m_attempt, m_iterations, average_distance, stop, m_evaluations, seconds() });
+			}
+		};
+	}
+}
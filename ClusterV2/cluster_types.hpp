@@ -0,0 +1,115 @@
+#pragma once
+
+#include "matrix.hpp"
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace cluster
+{
+	//======= TYPE DEFINITIONS ====================
+
+	using value_t = double; // value type of centroids
+	using data_t = double;
+
+	using data_row_t = std::vector<value_t>;
+	using data_row_list_t = std::vector<data_row_t>;
+
+	using value_row_t = std::vector<value_t>;
+	using value_row_list_t = std::vector<value_row_t>;
+
+	using data_matrix_t = Matrix<data_t>;          // contiguous rows, owns its memory
+	using data_view_t = MatrixView<data_t const>;  // contiguous rows, caller owns the memory
+
+	using value_matrix_t = Matrix<value_t>;
+	using value_view_t = MatrixView<value_t const>;
+
+	using index_list_t = std::vector<size_t>;
+
+	using dist_func_t = std::function<double(data_row_t const& data, value_row_t const& centroid)>;
+	using row_dist_func_t = std::function<double(data_t const* data, value_t const* centroid, size_t size)>;
+	using to_value_funct_t = std::function<value_t(data_t data)>;
+
+
+	constexpr size_t dynamic_dimension = 0; // number of values in each row is only known at runtime
+
+
+	typedef struct ClusterResult
+	{
+		index_list_t x_clusters;      // the cluster index of each data point
+		value_row_list_t centroids;   // centroids found
+		value_t average_distance = 0; //
+
+	} cluster_result_t;
+
+
+	typedef struct MatrixResult
+	{
+		index_list_t x_clusters;      // the cluster index of each data point
+		value_matrix_t centroids;     // centroids found, one per row
+		value_t average_distance = 0; //
+
+	} matrix_result_t;
+
+
+	enum class parallel_t
+	{
+		attempts, // each thread runs whole clustering attempts
+		data      // attempts run one at a time, the data of each iteration is split over the threads
+	};
+
+
+	enum class algorithm_t
+	{
+		lloyd,      // compares every row with every centroid in each iteration
+		elkan,      // keeps a lower bound for each row and centroid to skip most distance calculations
+		hamerly,    // keeps a single lower bound for each row, less memory than elkan for many clusters
+		automatic,  // elkan or hamerly depending on the size of the data and the number of clusters
+		mini_batch, // moves the centroids using random batches of data, see mini_batch_t
+		approximate // searches only the centroids close to each row, for very many clusters, see approximate_t
+	};
+
+
+	enum class seeding_t
+	{
+		random,         // random rows of data
+		kmeans_pp,      // k-means++, each centroid is chosen far from the ones before it, one pass over the data per cluster
+		kmeans_parallel // k-means||, like k-means++ with a few passes that each choose many centroids
+	};
+
+
+	enum class selection_t
+	{
+		min_distance, // the attempt with the smallest average distance, attempts can run in parallel
+		max_count     // the result found by the most attempts, stops once no other result can catch up
+	};
+
+
+	typedef struct MiniBatch
+	{
+		size_t batch_size = 1024;         // rows in each batch
+		size_t max_batches = 1000;        // most batches in each attempt
+		size_t max_no_improvement = 10;   // stops after this many batches without lowering the smoothed batch distance
+		double tolerance = 0;             // stops when no centroid value changes by more than this in a batch
+		bool assign_all = true;           // finds the cluster of every row at the end, otherwise x_clusters is empty
+
+	} mini_batch_t;
+
+
+	typedef struct Approximate
+	{
+		size_t groups = 0;      // groups the centroids are split into, 0 uses the square root of the number of clusters
+		size_t probes = 8;      // closest groups searched for each row, more finds the closest centroid more often but is slower
+		size_t iterations = 4;  // k-means passes that group the centroids each time they change
+
+	} approximate_t;
+
+
+	typedef struct DistanceResult
+	{
+		size_t index;    // index of centroid in the list
+		double distance; // calculated distance of data from the centroid
+
+	} distance_result_t;
+}
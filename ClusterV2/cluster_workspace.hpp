@@ -0,0 +1,176 @@
+#pragma once
+
+#include "cluster_algorithms.hpp"
+
+#include <memory>
+#include <mutex>
+
+// scratch buffers and the result of clustering, kept from one call to the next
+// once the buffers have grown to the size of the data, lloyd clustering with random or k-means++ seeding
+// does not allocate, which matters for short clustering jobs that run often
+namespace cluster
+{
+	//======= CLASS DEFINITION =======================
+
+	// one workspace must not be used by two calls at the same time
+	template<typename Result>
+	class ClusterWorkspace
+	{
+	public:
+
+		using attempt_t = algorithms::AttemptWorkspace<Result>;
+
+	private:
+
+		std::vector<std::unique_ptr<attempt_t>> m_attempts; // one for each attempt running at the same time
+		std::vector<attempt_t*> m_free;
+		std::mutex m_mutex;
+
+		Result m_result;
+		std::vector<double> m_norms; // row norms of blocked assignment
+
+	public:
+
+		ClusterWorkspace() = default;
+
+		ClusterWorkspace(ClusterWorkspace const&) = delete;
+		ClusterWorkspace& operator=(ClusterWorkspace const&) = delete;
+
+		// makes room for num_attempts attempts running at the same time, all of them free
+		void reserve(size_t num_attempts)
+		{
+			while (m_attempts.size() < num_attempts)
+				m_attempts.push_back(std::make_unique<attempt_t>());
+
+			m_free.clear();
+			for (auto const& attempt : m_attempts)
+				m_free.push_back(attempt.get());
+		}
+
+		// buffers for an attempt, reserve must have made room for every attempt running at the same time
+		attempt_t& acquire()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto attempt = m_free.back();
+			m_free.pop_back();
+
+			return *attempt;
+		}
+
+		void release(attempt_t& attempt)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_free.push_back(&attempt);
+		}
+
+		// result of the last call, valid until the workspace is used again
+		Result& result() { return m_result; }
+		Result const& result() const { return m_result; }
+
+		std::vector<double>& norms() { return m_norms; }
+	};
+
+
+	using cluster_workspace_t = ClusterWorkspace<cluster_result_t>;
+	using matrix_workspace_t = ClusterWorkspace<matrix_result_t>;
+
+
+	namespace algorithms
+	{
+		// same as cluster_min_distance with each attempt working in buffers of the workspace
+		// cluster_once(x_list, num_clusters, attempt, seed, buffers) leaves its result in buffers.result, attempt counts from 0
+		// the smallest result is copied into the workspace result, reusing its storage
+		template<typename L, typename F, typename Result>
+		Result& cluster_min_distance(L const& x_list, size_t num_clusters, F const& cluster_once, ThreadPool& pool, uint64_t seed, size_t num_attempts, ClusterWorkspace<Result>& workspace)
+		{
+			workspace.reserve(std::min(pool.size(), num_attempts));
+
+			auto& min = workspace.result();
+			size_t min_attempt = num_attempts;
+			std::mutex min_mutex;
+
+			auto const task = [&](size_t attempt)
+			{
+				auto& current = workspace.acquire();
+				cluster_once(x_list, num_clusters, attempt, attempt_seed(seed, attempt), current);
+
+				{
+					std::lock_guard<std::mutex> lock(min_mutex);
+
+					const bool is_min = min_attempt == num_attempts
+						|| current.result.average_distance < min.average_distance
+						|| (current.result.average_distance == min.average_distance && attempt < min_attempt);
+
+					if (is_min)
+					{
+						min = current.result;
+						min_attempt = attempt;
+					}
+				}
+
+				workspace.release(current);
+			};
+
+			pool.run(num_attempts, std::cref(task));
+
+			return min;
+		}
+
+
+		// returns the most popular result, attempts run one after the other
+		// results are told apart by a hash of their labels, which relabel_clusters has put in order of first appearance
+		// only one copy of each distinct result is kept
+		// stops as soon as no other result can catch up with the most popular one,
+		// which includes the most popular one having been found for more than half of the attempts
+		template<typename L, typename F, typename Result>
+		Result& cluster_max_count(L const& x_list, size_t num_clusters, F const& cluster_once, uint64_t seed, size_t num_attempts, ClusterWorkspace<Result>& workspace)
+		{
+			workspace.reserve(1);
+			auto& current = workspace.acquire();
+
+			std::vector<ResultCount<Result>> counts;
+			size_t best = 0; // earliest result with the highest count
+
+			for (size_t attempt = 0; attempt < num_attempts; ++attempt)
+			{
+				cluster_once(x_list, num_clusters, attempt, attempt_seed(seed, attempt), current);
+				const auto hash = hash_labels(current.result.x_clusters);
+
+				const auto same = [&](ResultCount<Result> const& c) { return c.hash == hash && c.result.x_clusters == current.result.x_clusters; };
+
+				auto found = std::find_if(counts.begin(), counts.end(), same);
+				if (found == counts.end())
+				{
+					counts.push_back({ current.result, 0, hash });
+					found = counts.end() - 1;
+				}
+
+				++found->count;
+
+				unsigned runner_up = 0;
+				for (size_t c = 0; c < counts.size(); ++c)
+				{
+					if (counts[c].count > counts[best].count)
+						best = c;
+				}
+
+				for (size_t c = 0; c < counts.size(); ++c)
+				{
+					if (c != best)
+						runner_up = std::max(runner_up, counts[c].count);
+				}
+
+				const auto remaining = num_attempts - attempt - 1;
+				if (counts[best].count > runner_up + remaining)
+					break;
+			}
+
+			workspace.release(current);
+			workspace.result() = std::move(counts[best].result);
+
+			return workspace.result();
+		}
+	}
+}
@@ -0,0 +1,334 @@
+#include "dataset.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+
+namespace cluster
+{
+	//======= HELPERS ==============================
+
+	static bool is_valid(dataset_header_t const& header, size_t file_size)
+	{
+		if (std::memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0)
+			return false;
+
+		if (header.version != DATASET_VERSION || header.element_type != static_cast<uint32_t>(element_t::float64))
+			return false;
+
+		if (header.data_offset < sizeof(dataset_header_t) || header.data_offset % sizeof(data_t) != 0)
+			return false;
+
+		if (!header.dimension || header.data_offset > file_size)
+			return false;
+
+		return header.num_rows <= (file_size - header.data_offset) / sizeof(data_t) / header.dimension;
+	}
+
+
+	//======= MAPPED FILE ==========================
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		close();
+
+		m_map = std::exchange(other.m_map, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+
+	#ifdef _WIN32
+		m_file = std::exchange(other.m_file, nullptr);
+		m_mapping = std::exchange(other.m_mapping, nullptr);
+	#endif
+
+		return *this;
+	}
+
+
+#ifdef _WIN32
+
+	bool MappedFile::open(std::string const& path, size_t min_size, bool sequential)
+	{
+		close();
+
+		auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		HANDLE mapping = nullptr;
+		void const* map = nullptr;
+
+		if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && static_cast<uint64_t>(file_size.QuadPart) >= min_size)
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping)
+			map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (!map)
+		{
+			if (mapping)
+				CloseHandle(mapping);
+
+			CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_map = map;
+		m_size = static_cast<size_t>(file_size.QuadPart);
+
+		return true;
+	}
+
+
+	void MappedFile::close()
+	{
+		if (m_map)
+			UnmapViewOfFile(m_map);
+
+		if (m_mapping)
+			CloseHandle(m_mapping);
+
+		if (m_file)
+			CloseHandle(m_file);
+
+		m_map = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+	}
+
+
+	void MappedFile::will_need(size_t, size_t) const
+	{
+		// PrefetchVirtualMemory needs Windows 8, pages are read when first touched
+	}
+
+#else
+
+	bool MappedFile::open(std::string const& path, size_t min_size, bool sequential)
+	{
+		close();
+
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		void* map = MAP_FAILED;
+
+		if (fstat(fd, &st) == 0 && st.st_size > 0 && static_cast<uint64_t>(st.st_size) >= min_size)
+			map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+		::close(fd); // the mapping keeps the file open
+
+		if (map == MAP_FAILED)
+			return false;
+
+		m_map = map;
+		m_size = static_cast<size_t>(st.st_size);
+
+		if (sequential)
+			madvise(map, m_size, MADV_SEQUENTIAL);
+
+		return true;
+	}
+
+
+	void MappedFile::close()
+	{
+		if (m_map)
+			munmap(const_cast<void*>(m_map), m_size);
+
+		m_map = nullptr;
+		m_size = 0;
+	}
+
+
+	void MappedFile::will_need(size_t offset, size_t size) const
+	{
+		if (!m_map || offset >= m_size)
+			return;
+
+		// madvise takes whole pages
+		const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const auto begin = offset / page * page;
+		const auto end = std::min(offset + size, m_size);
+
+		madvise(const_cast<char*>(static_cast<char const*>(m_map)) + begin, end - begin, MADV_WILLNEED);
+	}
+
+#endif
+
+
+	//======= MAPPED DATASET =======================
+
+	MappedDataset::MappedDataset(MappedDataset&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+
+	MappedDataset& MappedDataset::operator=(MappedDataset&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		m_file = std::move(other.m_file);
+		m_view = std::exchange(other.m_view, data_view_t());
+
+		return *this;
+	}
+
+
+	bool MappedDataset::open(std::string const& path)
+	{
+		close();
+
+		// not sequential, every iteration of every attempt reads the rows again
+		// and the sequential hint lets the system drop pages as soon as they have been read
+		if (!m_file.open(path, sizeof(dataset_header_t), false))
+			return false;
+
+		auto const& header = *static_cast<dataset_header_t const*>(m_file.data());
+		if (!is_valid(header, m_file.size()))
+		{
+			close();
+			return false;
+		}
+
+		auto const data = reinterpret_cast<data_t const*>(static_cast<char const*>(m_file.data()) + header.data_offset);
+		m_view = data_view_t(data, header.num_rows, header.dimension);
+
+		return true;
+	}
+
+
+	void MappedDataset::close()
+	{
+		m_file.close();
+		m_view = data_view_t();
+	}
+
+
+	//======= DATASET WRITER =======================
+
+	bool DatasetWriter::open(std::string const& path, size_t dimension)
+	{
+		close();
+
+		if (!dimension)
+			return false;
+
+		m_file = std::fopen(path.c_str(), "wb");
+		if (!m_file)
+			return false;
+
+		m_dimension = dimension;
+		m_num_rows = 0;
+
+		dataset_header_t header = {};
+		if (std::fwrite(&header, sizeof(header), 1, m_file) == 1) // filled in by close
+			return true;
+
+		std::fclose(m_file);
+		m_file = nullptr;
+
+		return false;
+	}
+
+
+	bool DatasetWriter::append(data_t const* row)
+	{
+		if (!m_file || std::fwrite(row, sizeof(data_t), m_dimension, m_file) != m_dimension)
+			return false;
+
+		++m_num_rows;
+
+		return true;
+	}
+
+
+	bool DatasetWriter::close()
+	{
+		if (!m_file)
+			return false;
+
+		dataset_header_t header = {};
+		std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+		header.version = DATASET_VERSION;
+		header.element_type = static_cast<uint32_t>(element_t::float64);
+		header.num_rows = m_num_rows;
+		header.dimension = m_dimension;
+		header.data_offset = DATASET_DATA_OFFSET;
+
+		bool ok = std::fflush(m_file) == 0 && !std::ferror(m_file);
+		ok = ok && std::fseek(m_file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+		ok = std::fclose(m_file) == 0 && ok;
+
+		m_file = nullptr;
+
+		return ok;
+	}
+
+
+	//======= FUNCTIONS =========================
+
+	bool write_dataset(std::string const& path, data_view_t const& x_list)
+	{
+		DatasetWriter writer;
+		if (!writer.open(path, x_list.dimension()))
+			return false;
+
+		for (size_t i = 0; i < x_list.size(); ++i)
+		{
+			if (!writer.append(x_list[i]))
+				return false;
+		}
+
+		return writer.close();
+	}
+
+
+	bool write_dataset(std::string const& path, data_row_list_t const& x_list)
+	{
+		DatasetWriter writer;
+		if (x_list.empty() || !writer.open(path, x_list[0].size()))
+			return false;
+
+		for (auto const& row : x_list)
+		{
+			if (!writer.append(row))
+				return false;
+		}
+
+		return writer.close();
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "cluster_types.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// binary data set files
+// a 64 byte header followed by the rows, tightly packed and row-major
+// the file is memory mapped for clustering so rows are only read from disk as the clustering loops reach them,
+// data larger than RAM is paged in and out by the operating system
+namespace cluster
+{
+	//======= TYPE DEFINITIONS ====================
+
+	constexpr char DATASET_MAGIC[8] = { 'K', 'M', 'E', 'A', 'N', 'S', 'D', 'S' };
+	constexpr uint32_t DATASET_VERSION = 1;
+	constexpr uint64_t DATASET_DATA_OFFSET = 64; // rows start on a cache line
+
+
+	enum class element_t : uint32_t
+	{
+		float64 = 1 // data_t
+	};
+
+
+	typedef struct DatasetHeader
+	{
+		char magic[8];          // DATASET_MAGIC
+		uint32_t version;       // DATASET_VERSION
+		uint32_t element_type;  // element_t of every value
+		uint64_t num_rows;      //
+		uint64_t dimension;     // values in each row
+		uint64_t data_offset;   // bytes from the start of the file to the first row
+		uint8_t reserved[24];   // zero
+
+	} dataset_header_t;
+
+	static_assert(sizeof(dataset_header_t) == DATASET_DATA_OFFSET, "dataset header must fill the space before the rows");
+
+
+	//======= CLASS DEFINITIONS =======================
+
+	// read only memory map of a whole file
+	class MappedFile
+	{
+	private:
+
+		void const* m_map = nullptr;
+		size_t m_size = 0;
+
+	#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+	#endif
+
+	public:
+
+		MappedFile() = default;
+		~MappedFile() { close(); }
+
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// maps the file, returns false if it cannot be opened or is smaller than min_size
+		// sequential tells the system the file will be read front to back once, pages may be dropped soon after they are read
+		bool open(std::string const& path, size_t min_size, bool sequential);
+
+		void close();
+
+		bool is_open() const { return m_map != nullptr; }
+
+		void const* data() const { return m_map; }
+
+		size_t size() const { return m_size; }
+
+		// asks the system to start reading bytes [offset, offset + size) from disk, does nothing where it is not supported
+		void will_need(size_t offset, size_t size) const;
+	};
+
+
+	// read only memory map of a data set file
+	class MappedDataset
+	{
+	private:
+
+		MappedFile m_file;
+		data_view_t m_view;
+
+	public:
+
+		MappedDataset() = default;
+		~MappedDataset() { close(); }
+
+		MappedDataset(MappedDataset const&) = delete;
+		MappedDataset& operator=(MappedDataset const&) = delete;
+
+		MappedDataset(MappedDataset&& other) noexcept;
+		MappedDataset& operator=(MappedDataset&& other) noexcept;
+
+		// maps the file, returns false if it cannot be opened or is not a valid data set
+		bool open(std::string const& path);
+
+		void close();
+
+		bool is_open() const { return m_file.is_open(); }
+
+		size_t size() const { return m_view.size(); }
+
+		size_t dimension() const { return m_view.dimension(); }
+
+		// rows in the file, valid until the data set is closed
+		data_view_t view() const { return m_view; }
+
+		operator data_view_t() const { return m_view; }
+	};
+
+
+	// writes a data set file one row at a time so data larger than RAM can be converted
+	class DatasetWriter
+	{
+	private:
+
+		std::FILE* m_file = nullptr;
+		size_t m_dimension = 0;
+		uint64_t m_num_rows = 0;
+
+	public:
+
+		DatasetWriter() = default;
+		~DatasetWriter() { close(); }
+
+		DatasetWriter(DatasetWriter const&) = delete;
+		DatasetWriter& operator=(DatasetWriter const&) = delete;
+
+		// creates the file, returns false if it cannot be created
+		bool open(std::string const& path, size_t dimension);
+
+		// appends a row of dimension values
+		bool append(data_t const* row);
+
+		bool append(data_row_t const& row) { return row.size() == m_dimension && append(row.data()); }
+
+		// writes the final row count, returns false if any write failed
+		bool close();
+	};
+
+
+	//======= FUNCTIONS =========================
+
+	bool write_dataset(std::string const& path, data_view_t const& x_list);
+
+	bool write_dataset(std::string const& path, data_row_list_t const& x_list);
+}
@@ -0,0 +1,727 @@
+#include "distance.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define CLUSTER_SIMD_X86
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+#elif defined(_MSC_VER) && defined(_M_X64)
+
+#include <immintrin.h>
+#include <intrin.h>
+
+#define CLUSTER_SIMD_X86
+#define TARGET_AVX2
+#define TARGET_AVX512
+
+#endif
+
+
+namespace cluster
+{
+	//======= CONSTANTS ==============================
+
+	constexpr size_t TILE_ROWS = 4;            // rows in each block of dot products
+	constexpr size_t PANEL_WIDTH = 8;          // centroids packed together, one AVX-512 vector
+	constexpr size_t CHUNK_ROWS = 128;         // rows kept in cache while every centroid block is compared with them
+	constexpr size_t BLOCK_BYTES = 64 * 1024;  // packed centroids compared with a chunk of rows before moving on
+
+
+	using dot_tile_t = void(*)(double const* const* rows, double const* panel, size_t size, double* dots);
+
+
+	//======= SCALAR ==============================
+
+	static double squared_row(double const* data, double const* row, size_t size)
+	{
+		double sum = 0;
+		for (size_t i = 0; i < size; ++i)
+			sum += (data[i] - row[i]) * (data[i] - row[i]);
+
+		return sum;
+	}
+
+
+	static double manhattan_row(double const* data, double const* row, size_t size)
+	{
+		double sum = 0;
+		for (size_t i = 0; i < size; ++i)
+			sum += std::abs(data[i] - row[i]);
+
+		return sum;
+	}
+
+
+	static double cosine_distance(double dot, double data_norm, double row_norm)
+	{
+		if (data_norm == 0 || row_norm == 0)
+			return 1.0;
+
+		return 1.0 - dot / std::sqrt(data_norm * row_norm);
+	}
+
+
+	static void squared_scalar(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		for (size_t r = 0; r < num_rows; ++r)
+			distances[r] = squared_row(data, rows + r * stride, size);
+	}
+
+
+	static void manhattan_scalar(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		for (size_t r = 0; r < num_rows; ++r)
+			distances[r] = manhattan_row(data, rows + r * stride, size);
+	}
+
+
+	static void cosine_scalar(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		double data_norm = 0;
+		for (size_t i = 0; i < size; ++i)
+			data_norm += data[i] * data[i];
+
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			auto row = rows + r * stride;
+
+			double dot = 0;
+			double row_norm = 0;
+			for (size_t i = 0; i < size; ++i)
+			{
+				dot += data[i] * row[i];
+				row_norm += row[i] * row[i];
+			}
+
+			distances[r] = cosine_distance(dot, data_norm, row_norm);
+		}
+	}
+
+
+	// dot products of TILE_ROWS rows with the PANEL_WIDTH centroids of a packed panel
+	// panel holds value d of centroid j at panel[d * PANEL_WIDTH + j], dots[r * PANEL_WIDTH + j] is row r with centroid j
+	static void dot_tile_scalar(double const* const* rows, double const* panel, size_t size, double* dots)
+	{
+		for (size_t t = 0; t < TILE_ROWS * PANEL_WIDTH; ++t)
+			dots[t] = 0;
+
+		for (size_t d = 0; d < size; ++d)
+		{
+			for (size_t r = 0; r < TILE_ROWS; ++r)
+			{
+				const auto x = rows[r][d];
+				for (size_t j = 0; j < PANEL_WIDTH; ++j)
+					dots[r * PANEL_WIDTH + j] += x * panel[d * PANEL_WIDTH + j];
+			}
+		}
+	}
+
+
+#ifdef CLUSTER_SIMD_X86
+
+	//======= AVX2 ==============================
+
+	// four rows are compared at a time so each load of data is used four times
+
+	TARGET_AVX2
+	static double hsum_avx2(__m256d v)
+	{
+		auto sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+
+		return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+	}
+
+
+	TARGET_AVX2
+	static void squared_avx2(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 4;
+
+		size_t r = 0;
+		for (; r + 4 <= num_rows; r += 4)
+		{
+			auto const row0 = rows + r * stride;
+			auto const row1 = row0 + stride;
+			auto const row2 = row1 + stride;
+			auto const row3 = row2 + stride;
+
+			auto acc0 = _mm256_setzero_pd();
+			auto acc1 = _mm256_setzero_pd();
+			auto acc2 = _mm256_setzero_pd();
+			auto acc3 = _mm256_setzero_pd();
+
+			for (size_t i = 0; i < vec_size; i += 4)
+			{
+				auto const x = _mm256_loadu_pd(data + i);
+
+				auto const d0 = _mm256_sub_pd(x, _mm256_loadu_pd(row0 + i));
+				auto const d1 = _mm256_sub_pd(x, _mm256_loadu_pd(row1 + i));
+				auto const d2 = _mm256_sub_pd(x, _mm256_loadu_pd(row2 + i));
+				auto const d3 = _mm256_sub_pd(x, _mm256_loadu_pd(row3 + i));
+
+				acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+				acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+				acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+				acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+			}
+
+			auto const tail = size - vec_size;
+			distances[r] = hsum_avx2(acc0) + squared_row(data + vec_size, row0 + vec_size, tail);
+			distances[r + 1] = hsum_avx2(acc1) + squared_row(data + vec_size, row1 + vec_size, tail);
+			distances[r + 2] = hsum_avx2(acc2) + squared_row(data + vec_size, row2 + vec_size, tail);
+			distances[r + 3] = hsum_avx2(acc3) + squared_row(data + vec_size, row3 + vec_size, tail);
+		}
+
+		for (; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto acc = _mm256_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 4)
+			{
+				auto const d = _mm256_sub_pd(_mm256_loadu_pd(data + i), _mm256_loadu_pd(row + i));
+				acc = _mm256_fmadd_pd(d, d, acc);
+			}
+
+			distances[r] = hsum_avx2(acc) + squared_row(data + vec_size, row + vec_size, size - vec_size);
+		}
+	}
+
+
+	TARGET_AVX2
+	static void manhattan_avx2(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 4;
+		auto const sign = _mm256_set1_pd(-0.0);
+
+		size_t r = 0;
+		for (; r + 4 <= num_rows; r += 4)
+		{
+			auto const row0 = rows + r * stride;
+			auto const row1 = row0 + stride;
+			auto const row2 = row1 + stride;
+			auto const row3 = row2 + stride;
+
+			auto acc0 = _mm256_setzero_pd();
+			auto acc1 = _mm256_setzero_pd();
+			auto acc2 = _mm256_setzero_pd();
+			auto acc3 = _mm256_setzero_pd();
+
+			for (size_t i = 0; i < vec_size; i += 4)
+			{
+				auto const x = _mm256_loadu_pd(data + i);
+
+				acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, _mm256_sub_pd(x, _mm256_loadu_pd(row0 + i))));
+				acc1 = _mm256_add_pd(acc1, _mm256_andnot_pd(sign, _mm256_sub_pd(x, _mm256_loadu_pd(row1 + i))));
+				acc2 = _mm256_add_pd(acc2, _mm256_andnot_pd(sign, _mm256_sub_pd(x, _mm256_loadu_pd(row2 + i))));
+				acc3 = _mm256_add_pd(acc3, _mm256_andnot_pd(sign, _mm256_sub_pd(x, _mm256_loadu_pd(row3 + i))));
+			}
+
+			auto const tail = size - vec_size;
+			distances[r] = hsum_avx2(acc0) + manhattan_row(data + vec_size, row0 + vec_size, tail);
+			distances[r + 1] = hsum_avx2(acc1) + manhattan_row(data + vec_size, row1 + vec_size, tail);
+			distances[r + 2] = hsum_avx2(acc2) + manhattan_row(data + vec_size, row2 + vec_size, tail);
+			distances[r + 3] = hsum_avx2(acc3) + manhattan_row(data + vec_size, row3 + vec_size, tail);
+		}
+
+		for (; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto acc = _mm256_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 4)
+				acc = _mm256_add_pd(acc, _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(data + i), _mm256_loadu_pd(row + i))));
+
+			distances[r] = hsum_avx2(acc) + manhattan_row(data + vec_size, row + vec_size, size - vec_size);
+		}
+	}
+
+
+	TARGET_AVX2
+	static void cosine_avx2(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 4;
+
+		auto data_acc = _mm256_setzero_pd();
+		for (size_t i = 0; i < vec_size; i += 4)
+		{
+			auto const x = _mm256_loadu_pd(data + i);
+			data_acc = _mm256_fmadd_pd(x, x, data_acc);
+		}
+
+		auto data_norm = hsum_avx2(data_acc);
+		for (size_t i = vec_size; i < size; ++i)
+			data_norm += data[i] * data[i];
+
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto dot_acc = _mm256_setzero_pd();
+			auto norm_acc = _mm256_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 4)
+			{
+				auto const c = _mm256_loadu_pd(row + i);
+				dot_acc = _mm256_fmadd_pd(_mm256_loadu_pd(data + i), c, dot_acc);
+				norm_acc = _mm256_fmadd_pd(c, c, norm_acc);
+			}
+
+			auto dot = hsum_avx2(dot_acc);
+			auto row_norm = hsum_avx2(norm_acc);
+			for (size_t i = vec_size; i < size; ++i)
+			{
+				dot += data[i] * row[i];
+				row_norm += row[i] * row[i];
+			}
+
+			distances[r] = cosine_distance(dot, data_norm, row_norm);
+		}
+	}
+
+
+	// each row value is broadcast once and used for the whole panel, each panel load is used for every row of the tile
+	TARGET_AVX2
+	static void dot_tile_avx2(double const* const* rows, double const* panel, size_t size, double* dots)
+	{
+		auto acc00 = _mm256_setzero_pd(), acc01 = _mm256_setzero_pd();
+		auto acc10 = _mm256_setzero_pd(), acc11 = _mm256_setzero_pd();
+		auto acc20 = _mm256_setzero_pd(), acc21 = _mm256_setzero_pd();
+		auto acc30 = _mm256_setzero_pd(), acc31 = _mm256_setzero_pd();
+
+		for (size_t d = 0; d < size; ++d)
+		{
+			auto const p0 = _mm256_loadu_pd(panel + d * PANEL_WIDTH);
+			auto const p1 = _mm256_loadu_pd(panel + d * PANEL_WIDTH + 4);
+
+			auto x = _mm256_broadcast_sd(rows[0] + d);
+			acc00 = _mm256_fmadd_pd(x, p0, acc00);
+			acc01 = _mm256_fmadd_pd(x, p1, acc01);
+
+			x = _mm256_broadcast_sd(rows[1] + d);
+			acc10 = _mm256_fmadd_pd(x, p0, acc10);
+			acc11 = _mm256_fmadd_pd(x, p1, acc11);
+
+			x = _mm256_broadcast_sd(rows[2] + d);
+			acc20 = _mm256_fmadd_pd(x, p0, acc20);
+			acc21 = _mm256_fmadd_pd(x, p1, acc21);
+
+			x = _mm256_broadcast_sd(rows[3] + d);
+			acc30 = _mm256_fmadd_pd(x, p0, acc30);
+			acc31 = _mm256_fmadd_pd(x, p1, acc31);
+		}
+
+		_mm256_storeu_pd(dots, acc00);
+		_mm256_storeu_pd(dots + 4, acc01);
+		_mm256_storeu_pd(dots + 8, acc10);
+		_mm256_storeu_pd(dots + 12, acc11);
+		_mm256_storeu_pd(dots + 16, acc20);
+		_mm256_storeu_pd(dots + 20, acc21);
+		_mm256_storeu_pd(dots + 24, acc30);
+		_mm256_storeu_pd(dots + 28, acc31);
+	}
+
+
+	//======= AVX-512 ==============================
+
+	// the last partial vector of each row is read with a mask, no scalar tail
+
+	TARGET_AVX512
+	static void squared_avx512(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 8;
+		const __mmask8 tail_mask = static_cast<__mmask8>((1u << (size % 8)) - 1);
+
+		size_t r = 0;
+		for (; r + 4 <= num_rows; r += 4)
+		{
+			auto const row0 = rows + r * stride;
+			auto const row1 = row0 + stride;
+			auto const row2 = row1 + stride;
+			auto const row3 = row2 + stride;
+
+			auto acc0 = _mm512_setzero_pd();
+			auto acc1 = _mm512_setzero_pd();
+			auto acc2 = _mm512_setzero_pd();
+			auto acc3 = _mm512_setzero_pd();
+
+			for (size_t i = 0; i < vec_size; i += 8)
+			{
+				auto const x = _mm512_loadu_pd(data + i);
+
+				auto const d0 = _mm512_sub_pd(x, _mm512_loadu_pd(row0 + i));
+				auto const d1 = _mm512_sub_pd(x, _mm512_loadu_pd(row1 + i));
+				auto const d2 = _mm512_sub_pd(x, _mm512_loadu_pd(row2 + i));
+				auto const d3 = _mm512_sub_pd(x, _mm512_loadu_pd(row3 + i));
+
+				acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+				acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+				acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+				acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+			}
+
+			if (tail_mask)
+			{
+				auto const x = _mm512_maskz_loadu_pd(tail_mask, data + vec_size);
+
+				auto const d0 = _mm512_sub_pd(x, _mm512_maskz_loadu_pd(tail_mask, row0 + vec_size));
+				auto const d1 = _mm512_sub_pd(x, _mm512_maskz_loadu_pd(tail_mask, row1 + vec_size));
+				auto const d2 = _mm512_sub_pd(x, _mm512_maskz_loadu_pd(tail_mask, row2 + vec_size));
+				auto const d3 = _mm512_sub_pd(x, _mm512_maskz_loadu_pd(tail_mask, row3 + vec_size));
+
+				acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+				acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+				acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+				acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+			}
+
+			distances[r] = _mm512_reduce_add_pd(acc0);
+			distances[r + 1] = _mm512_reduce_add_pd(acc1);
+			distances[r + 2] = _mm512_reduce_add_pd(acc2);
+			distances[r + 3] = _mm512_reduce_add_pd(acc3);
+		}
+
+		for (; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto acc = _mm512_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 8)
+			{
+				auto const d = _mm512_sub_pd(_mm512_loadu_pd(data + i), _mm512_loadu_pd(row + i));
+				acc = _mm512_fmadd_pd(d, d, acc);
+			}
+
+			if (tail_mask)
+			{
+				auto const d = _mm512_sub_pd(_mm512_maskz_loadu_pd(tail_mask, data + vec_size), _mm512_maskz_loadu_pd(tail_mask, row + vec_size));
+				acc = _mm512_fmadd_pd(d, d, acc);
+			}
+
+			distances[r] = _mm512_reduce_add_pd(acc);
+		}
+	}
+
+
+	TARGET_AVX512
+	static void manhattan_avx512(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 8;
+		const __mmask8 tail_mask = static_cast<__mmask8>((1u << (size % 8)) - 1);
+
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto acc = _mm512_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 8)
+				acc = _mm512_add_pd(acc, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(data + i), _mm512_loadu_pd(row + i))));
+
+			if (tail_mask)
+				acc = _mm512_add_pd(acc, _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(tail_mask, data + vec_size), _mm512_maskz_loadu_pd(tail_mask, row + vec_size))));
+
+			distances[r] = _mm512_reduce_add_pd(acc);
+		}
+	}
+
+
+	TARGET_AVX512
+	static void cosine_avx512(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances)
+	{
+		const size_t vec_size = size - size % 8;
+		const __mmask8 tail_mask = static_cast<__mmask8>((1u << (size % 8)) - 1);
+
+		auto data_acc = _mm512_setzero_pd();
+		for (size_t i = 0; i < vec_size; i += 8)
+		{
+			auto const x = _mm512_loadu_pd(data + i);
+			data_acc = _mm512_fmadd_pd(x, x, data_acc);
+		}
+
+		auto const x_tail = _mm512_maskz_loadu_pd(tail_mask, data + vec_size);
+		data_acc = _mm512_fmadd_pd(x_tail, x_tail, data_acc);
+
+		auto const data_norm = _mm512_reduce_add_pd(data_acc);
+
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			auto dot_acc = _mm512_setzero_pd();
+			auto norm_acc = _mm512_setzero_pd();
+			for (size_t i = 0; i < vec_size; i += 8)
+			{
+				auto const c = _mm512_loadu_pd(row + i);
+				dot_acc = _mm512_fmadd_pd(_mm512_loadu_pd(data + i), c, dot_acc);
+				norm_acc = _mm512_fmadd_pd(c, c, norm_acc);
+			}
+
+			auto const c_tail = _mm512_maskz_loadu_pd(tail_mask, row + vec_size);
+			dot_acc = _mm512_fmadd_pd(x_tail, c_tail, dot_acc);
+			norm_acc = _mm512_fmadd_pd(c_tail, c_tail, norm_acc);
+
+			distances[r] = cosine_distance(_mm512_reduce_add_pd(dot_acc), data_norm, _mm512_reduce_add_pd(norm_acc));
+		}
+	}
+
+
+	// a panel is one 512 bit vector
+	TARGET_AVX512
+	static void dot_tile_avx512(double const* const* rows, double const* panel, size_t size, double* dots)
+	{
+		auto acc0 = _mm512_setzero_pd();
+		auto acc1 = _mm512_setzero_pd();
+		auto acc2 = _mm512_setzero_pd();
+		auto acc3 = _mm512_setzero_pd();
+
+		for (size_t d = 0; d < size; ++d)
+		{
+			auto const p = _mm512_loadu_pd(panel + d * PANEL_WIDTH);
+
+			acc0 = _mm512_fmadd_pd(_mm512_set1_pd(rows[0][d]), p, acc0);
+			acc1 = _mm512_fmadd_pd(_mm512_set1_pd(rows[1][d]), p, acc1);
+			acc2 = _mm512_fmadd_pd(_mm512_set1_pd(rows[2][d]), p, acc2);
+			acc3 = _mm512_fmadd_pd(_mm512_set1_pd(rows[3][d]), p, acc3);
+		}
+
+		_mm512_storeu_pd(dots, acc0);
+		_mm512_storeu_pd(dots + 8, acc1);
+		_mm512_storeu_pd(dots + 16, acc2);
+		_mm512_storeu_pd(dots + 24, acc3);
+	}
+
+
+	//======= CPU DETECTION ==============================
+
+	static simd_t detect_simd()
+	{
+#if defined(_MSC_VER)
+
+		int info[4] = { 0 };
+		__cpuid(info, 0);
+		const int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		const bool has_fma = (info[2] & (1 << 12)) != 0;
+		const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+
+		if (max_leaf < 7 || !has_osxsave)
+			return simd_t::scalar;
+
+		const auto xcr0 = _xgetbv(0);
+		const bool os_avx = (xcr0 & 0x6) == 0x6;
+		const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		const bool has_avx2 = (info[1] & (1 << 5)) != 0;
+		const bool has_avx512f = (info[1] & (1 << 16)) != 0;
+
+		if (has_avx512f && os_avx512)
+			return simd_t::avx512;
+
+		if (has_avx2 && has_fma && os_avx)
+			return simd_t::avx2;
+
+		return simd_t::scalar;
+
+#else
+
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f"))
+			return simd_t::avx512;
+
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return simd_t::avx2;
+
+		return simd_t::scalar;
+
+#endif
+	}
+
+#else
+
+	static simd_t detect_simd()
+	{
+		return simd_t::scalar;
+	}
+
+#endif // CLUSTER_SIMD_X86
+
+
+	//======= DISPATCH ==============================
+
+	simd_t simd_level()
+	{
+		static const simd_t level = detect_simd();
+
+		return level;
+	}
+
+
+	distance_kernel_t distance_kernel(metric_t metric, simd_t simd)
+	{
+		if (static_cast<int>(simd) > static_cast<int>(simd_level()))
+			simd = simd_level();
+
+#ifdef CLUSTER_SIMD_X86
+
+		if (simd == simd_t::avx512)
+		{
+			switch (metric)
+			{
+			case metric_t::squared_euclidean: return squared_avx512;
+			case metric_t::manhattan: return manhattan_avx512;
+			case metric_t::cosine: return cosine_avx512;
+			default: return nullptr;
+			}
+		}
+
+		if (simd == simd_t::avx2)
+		{
+			switch (metric)
+			{
+			case metric_t::squared_euclidean: return squared_avx2;
+			case metric_t::manhattan: return manhattan_avx2;
+			case metric_t::cosine: return cosine_avx2;
+			default: return nullptr;
+			}
+		}
+
+#endif
+
+		switch (metric)
+		{
+		case metric_t::squared_euclidean: return squared_scalar;
+		case metric_t::manhattan: return manhattan_scalar;
+		case metric_t::cosine: return cosine_scalar;
+		default: return nullptr;
+		}
+	}
+
+
+	distance_kernel_t distance_kernel(metric_t metric)
+	{
+		return distance_kernel(metric, simd_level());
+	}
+
+
+	//======= BLOCKED ==============================
+
+	static dot_tile_t dot_tile(simd_t simd)
+	{
+#ifdef CLUSTER_SIMD_X86
+
+		if (simd == simd_t::avx512)
+			return dot_tile_avx512;
+
+		if (simd == simd_t::avx2)
+			return dot_tile_avx2;
+
+#endif
+
+		return dot_tile_scalar;
+	}
+
+
+	void squared_norms(double const* rows, size_t num_rows, size_t stride, size_t size, double* norms)
+	{
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			auto const row = rows + r * stride;
+
+			double sum = 0;
+			for (size_t i = 0; i < size; ++i)
+				sum += row[i] * row[i];
+
+			norms[r] = sum;
+		}
+	}
+
+
+	void closest_squared_euclidean(double const* rows, size_t num_rows, size_t row_stride, double const* row_norms,
+		double const* centroids, size_t num_centroids, size_t centroid_stride, size_t size, size_t* indexes, double* distances)
+	{
+		const auto tile = dot_tile(simd_level());
+		const auto num_panels = (num_centroids + PANEL_WIDTH - 1) / PANEL_WIDTH;
+		const auto panel_size = size * PANEL_WIDTH;
+		const auto block_panels = std::max(BLOCK_BYTES / (std::max(panel_size, size_t(1)) * sizeof(double)), size_t(1));
+
+		// centroids transposed into panels, padding centroids are never closest
+		thread_local std::vector<double> packed;
+		thread_local std::vector<double> centroid_norms;
+
+		packed.assign(num_panels * panel_size, 0);
+		centroid_norms.assign(num_panels * PANEL_WIDTH, std::numeric_limits<double>::infinity());
+
+		for (size_t c = 0; c < num_centroids; ++c)
+		{
+			auto const centroid = centroids + c * centroid_stride;
+			auto const panel = packed.data() + (c / PANEL_WIDTH) * panel_size + c % PANEL_WIDTH;
+
+			for (size_t d = 0; d < size; ++d)
+				panel[d * PANEL_WIDTH] = centroid[d];
+		}
+
+		squared_norms(centroids, num_centroids, centroid_stride, size, centroid_norms.data());
+
+		for (size_t r = 0; r < num_rows; ++r)
+		{
+			indexes[r] = 0;
+			distances[r] = std::numeric_limits<double>::max();
+		}
+
+		double dots[TILE_ROWS * PANEL_WIDTH];
+		double const* tile_rows[TILE_ROWS];
+
+		for (size_t chunk = 0; chunk < num_rows; chunk += CHUNK_ROWS)
+		{
+			const auto chunk_end = std::min(chunk + CHUNK_ROWS, num_rows);
+
+			for (size_t block = 0; block < num_panels; block += block_panels)
+			{
+				const auto block_end = std::min(block + block_panels, num_panels);
+
+				for (size_t r0 = chunk; r0 < chunk_end; r0 += TILE_ROWS)
+				{
+					const auto tile_size = std::min(TILE_ROWS, chunk_end - r0);
+
+					// a partial tile repeats its last row
+					for (size_t r = 0; r < TILE_ROWS; ++r)
+						tile_rows[r] = rows + (r0 + std::min(r, tile_size - 1)) * row_stride;
+
+					for (size_t p = block; p < block_end; ++p)
+					{
+						tile(tile_rows, packed.data() + p * panel_size, size, dots);
+
+						for (size_t r = 0; r < tile_size; ++r)
+						{
+							for (size_t j = 0; j < PANEL_WIDTH; ++j)
+							{
+								const auto c = p * PANEL_WIDTH + j;
+								const auto dist = row_norms[r0 + r] - 2 * dots[r * PANEL_WIDTH + j] + centroid_norms[c];
+
+								if (dist < distances[r0 + r])
+								{
+									distances[r0 + r] = dist;
+									indexes[r0 + r] = c;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// rounding can take a distance just below zero
+		for (size_t r = 0; r < num_rows; ++r)
+			distances[r] = std::max(distances[r], 0.0);
+	}
+}
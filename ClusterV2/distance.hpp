@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+namespace cluster
+{
+	//======= TYPES ===================
+
+	enum class metric_t
+	{
+		custom,            // distance functions set with set_distance / set_row_distance
+		squared_euclidean, // sum of (x - c)^2
+		manhattan,         // sum of |x - c|
+		cosine             // 1 - x.c / (|x| |c|), 1 when either row is all zeros
+	};
+
+
+	enum class simd_t
+	{
+		scalar,
+		avx2,   // AVX2 + FMA
+		avx512  // AVX-512F
+	};
+
+
+	// distances from one row of data to num_rows rows that are stride values apart
+	// writes one distance per row to distances
+	using distance_kernel_t = void(*)(double const* data, double const* rows, size_t num_rows, size_t stride, size_t size, double* distances);
+
+
+	//======= KERNELS ===================
+
+	// the best instruction set supported by this cpu, detected once
+	simd_t simd_level();
+
+	// kernel for a built-in metric using the given instruction set
+	// falls back to a lower instruction set when the one requested is not supported
+	distance_kernel_t distance_kernel(metric_t metric, simd_t simd);
+
+	// kernel for a built-in metric using the best instruction set available
+	distance_kernel_t distance_kernel(metric_t metric);
+
+
+	//======= BLOCKED ===================
+
+	// sum of the squares of each row
+	void squared_norms(double const* rows, size_t num_rows, size_t stride, size_t size, double* norms);
+
+	// closest centroid of each row by squared euclidean distance, calculated as |x|^2 - 2 x.c + |c|^2
+	// the dot products are done for blocks of rows and centroids that stay in cache, with the best instruction set available
+	// row_norms are from squared_norms so they can be calculated once for many calls
+	void closest_squared_euclidean(double const* rows, size_t num_rows, size_t row_stride, double const* row_norms,
+		double const* centroids, size_t num_centroids, size_t centroid_stride, size_t size, size_t* indexes, double* distances);
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "basic_cluster.hpp"
+#include "transport.hpp"
+
+#include <numeric>
+#include <limits>
+
+// k-means over data split between processes, each process holds one shard of the rows
+// every iteration each process assigns its own rows with the same assign_labels pass as BasicCluster,
+// then the cluster totals of all shards are added up through the transport and every process calculates the same centroids
+// only k * (dimension + 1) + 2 values are exchanged each iteration, whatever the number of rows
+namespace cluster
+{
+	//======= CLASS DEFINITION =======================
+
+	template<typename Distance = SquaredEuclidean, typename ToValue = Identity, size_t Dimension = dynamic_dimension>
+	class DistributedCluster
+	{
+	private:
+
+		Distance m_distance;
+		ToValue m_to_value;
+
+		Transport& m_transport;
+		std::shared_ptr<ThreadPool> m_pool;
+		uint64_t m_seed = 0;
+
+		template<typename D>
+		bool iterate(data_view_t const& shard, D const& distance, matrix_result_t& result);
+
+		bool gather(value_matrix_t const& rows, size_t data_size, std::vector<value_t>& all);
+
+		bool initial_centroids(data_view_t const& shard, size_t num_clusters, value_matrix_t& centroids);
+
+	public:
+
+		DistributedCluster(Transport& transport, Distance const& distance = Distance(), ToValue const& to_value = ToValue())
+			: m_distance(distance), m_to_value(to_value), m_transport(transport)
+		{
+			m_pool = std::make_shared<ThreadPool>(1);
+		}
+
+		// number of threads each process splits its shard over
+		// 0 uses all hardware threads, 1 (default) runs on the calling thread
+		void set_threads(size_t num_threads) { m_pool = std::make_shared<ThreadPool>(num_threads); }
+
+		// every process must use the same seed
+		// the starting centroids are chosen with k-means|| over all of the shards
+		void set_seed(uint64_t seed) { m_seed = seed; }
+
+		// every process calls this with its own shard and the same number of clusters
+		// the result holds the cluster of each row of this shard, and the centroids and average distance of all shards
+		// returns false if the transport failed
+		bool cluster_data(data_view_t const& shard, size_t num_clusters, matrix_result_t& result);
+	};
+
+
+	//======= CLASS METHODS ==============================
+
+	// the rows of every process one after the other in rank order, every process receives the same rows
+	template<typename Distance, typename ToValue, size_t Dimension>
+	bool DistributedCluster<Distance, ToValue, Dimension>::gather(value_matrix_t const& rows, size_t data_size, std::vector<value_t>& all)
+	{
+		const auto num_processes = m_transport.size();
+		const auto rank = m_transport.rank();
+
+		std::vector<double> counts(num_processes, 0);
+		counts[rank] = static_cast<double>(rows.size());
+
+		if (!m_transport.all_reduce(counts.data(), counts.size()))
+			return false;
+
+		size_t offset = 0;
+		size_t num_rows = 0;
+		for (size_t r = 0; r < num_processes; ++r)
+		{
+			offset += r < rank ? static_cast<size_t>(counts[r]) : 0;
+			num_rows += static_cast<size_t>(counts[r]);
+		}
+
+		// each process fills its own rows, the others are zero so adding them up gathers every row
+		std::vector<double> values(num_rows * data_size, 0);
+		for (size_t k = 0; k < rows.size(); ++k)
+			std::copy(rows[k], rows[k] + data_size, values.data() + (offset + k) * data_size);
+
+		if (!m_transport.all_reduce(values.data(), values.size()))
+			return false;
+
+		all.insert(all.end(), values.begin(), values.end());
+
+		return true;
+	}
+
+
+	// k-means|| over all of the shards, same as algorithms::get_kmeans_parallel_centroids
+	// each shard samples its own rows, the sampled rows and their weights are gathered by every process,
+	// which then reduces them to the same num_clusters centroids with k-means++
+	template<typename Distance, typename ToValue, size_t Dimension>
+	bool DistributedCluster<Distance, ToValue, Dimension>::initial_centroids(data_view_t const& shard, size_t num_clusters, value_matrix_t& centroids)
+	{
+		constexpr size_t num_rounds = 5;
+
+		const auto num_data = shard.size();
+		const auto data_size = shard.dimension();
+		const auto oversampling = 2.0 * num_clusters;
+		const auto shard_seed = algorithms::attempt_seed(m_seed, m_transport.rank());
+
+		std::vector<double> min_distances(num_data, std::numeric_limits<double>::max());
+		std::vector<value_t> candidates; // rows of data_size values
+
+		// one random row of each shard to start from
+		value_matrix_t added(num_data ? 1 : 0, data_size);
+		if (num_data)
+		{
+			std::mt19937_64 gen{ shard_seed };
+			algorithms::set_centroid(added[0], shard[std::uniform_int_distribution<size_t>(0, num_data - 1)(gen)], m_to_value, data_size);
+		}
+
+		for (size_t round = 0; ; ++round)
+		{
+			const auto first = candidates.size() / data_size;
+			if (!gather(added, data_size, candidates))
+				return false;
+
+			const auto num_candidates = candidates.size() / data_size;
+			if (num_candidates == first)
+				break;
+
+			const value_view_t all(candidates.data(), num_candidates, data_size);
+			algorithms::update_min_distances<Dimension>(shard, all, first, num_candidates, m_distance, min_distances, *m_pool);
+
+			if (round == num_rounds)
+				break;
+
+			double total = 0;
+			for (auto const dist : min_distances)
+				total += dist;
+
+			if (!m_transport.all_reduce(&total, 1))
+				return false;
+
+			index_list_t sampled;
+			for (size_t i = 0; i < num_data && total > 0; ++i)
+			{
+				if (algorithms::hash_uniform(shard_seed, round * num_data + i) * total < oversampling * min_distances[i])
+					sampled.push_back(i);
+			}
+
+			added = value_matrix_t(sampled.size(), data_size);
+			for (size_t j = 0; j < sampled.size(); ++j)
+				algorithms::set_centroid(added[j], shard[sampled[j]], m_to_value, data_size);
+		}
+
+		const auto num_candidates = candidates.size() / data_size;
+		const value_view_t all(candidates.data(), num_candidates, data_size);
+
+		// weight of each candidate is the number of rows of all shards closest to it
+		const auto num_ranges = algorithms::num_data_ranges(*m_pool, num_data);
+		std::vector<std::vector<double>> range_weights(num_ranges, std::vector<double>(num_candidates, 0));
+
+		algorithms::for_each_range(*m_pool, num_data, [&](size_t range, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				++range_weights[range][algorithms::closest<Dimension>(m_distance, shard[i], all).index];
+		});
+
+		auto weights = std::move(range_weights[0]);
+		for (size_t r = 1; r < num_ranges; ++r)
+		{
+			for (size_t j = 0; j < num_candidates; ++j)
+				weights[j] += range_weights[r][j];
+		}
+
+		if (!m_transport.all_reduce(weights.data(), weights.size()))
+			return false;
+
+		index_list_t rows(num_candidates);
+		std::iota(rows.begin(), rows.end(), size_t(0));
+
+		auto const identity = [](data_t value) { return value; };
+		std::mt19937_64 gen{ m_seed }; // the same on every process
+
+		centroids = algorithms::get_weighted_centroids<value_matrix_t, Dimension>(all, rows, weights, num_clusters, m_distance, identity, gen);
+
+		return true;
+	}
+
+
+	// lloyd iterations with the totals of every shard added up through the transport
+	template<typename Distance, typename ToValue, size_t Dimension>
+	template<typename D>
+	bool DistributedCluster<Distance, ToValue, Dimension>::iterate(data_view_t const& shard, D const& distance, matrix_result_t& result)
+	{
+		const auto num_clusters = result.centroids.size();
+		const auto data_size = result.centroids.dimension();
+
+		algorithms::cluster_sums_t<value_matrix_t> sums;
+		algorithms::ClusterBuffers<value_matrix_t> buffers;
+		value_matrix_t centroids_try = result.centroids;
+		index_list_t x_clusters_try(shard.size());
+
+		// totals of the values and counts of each cluster, then the total distance and changed rows
+		std::vector<double> totals(num_clusters * (data_size + 1) + 2);
+
+		result.x_clusters.assign(shard.size(), num_clusters);
+
+		for (size_t i = 0; i <= CLUSTER_ITERATIONS; ++i)
+		{
+			auto& centroids = i ? centroids_try : result.centroids;
+			auto& x_clusters = i ? x_clusters_try : result.x_clusters;
+
+			const auto assignment = algorithms::assign_labels<Dimension>(shard, centroids, distance, m_to_value, *m_pool, result.x_clusters, x_clusters, sums, buffers);
+
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				std::copy(sums.values[k], sums.values[k] + data_size, totals.data() + k * data_size);
+				totals[num_clusters * data_size + k] = sums.counts[k];
+			}
+
+			totals[totals.size() - 2] = assignment.total_distance;
+			totals[totals.size() - 1] = static_cast<double>(assignment.changed);
+
+			if (!m_transport.all_reduce(totals.data(), totals.size()))
+				return false;
+
+			// every process now holds the same totals and so calculates the same centroids
+			double num_rows = 0;
+			for (size_t k = 0; k < num_clusters; ++k)
+			{
+				std::copy(totals.data() + k * data_size, totals.data() + (k + 1) * data_size, sums.values[k]);
+				sums.counts[k] = static_cast<unsigned>(totals[num_clusters * data_size + k]);
+				num_rows += totals[num_clusters * data_size + k];
+			}
+
+			if (i)
+			{
+				std::swap(result.x_clusters, x_clusters_try);
+				std::swap(result.centroids, centroids_try);
+			}
+
+			result.average_distance = num_rows ? totals[totals.size() - 2] / num_rows : 0;
+
+			if (i && !totals.back())
+				break;
+
+			if (i == CLUSTER_ITERATIONS || algorithms::update_centroids<Dimension>(sums, result.centroids, centroids_try) <= CLUSTER_TOLERANCE)
+				break;
+		}
+
+		return true;
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	bool DistributedCluster<Distance, ToValue, Dimension>::cluster_data(data_view_t const& shard, size_t num_clusters, matrix_result_t& result)
+	{
+		if (!initial_centroids(shard, num_clusters, result.centroids))
+			return false;
+
+		if (algorithms::use_blocked(m_distance, result.centroids.dimension()))
+		{
+			std::vector<double> norms;
+			const algorithms::BlockedDistance<Distance> blocked(m_distance, shard, *m_pool, norms);
+
+			return iterate(shard, blocked, result);
+		}
+
+		return iterate(shard, m_distance, result);
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <algorithm>
+
+namespace cluster
+{
+	//======= CONSTANTS ========================
+
+	constexpr size_t MATRIX_ALIGNMENT = 64; // bytes, start of each owned row is aligned to a cache line
+
+
+	//======= MATRIX VIEW =======================
+
+	// non-owning row-major view of a block of memory
+	// rows are stride elements apart, only the first dimension elements of each row are used
+	template<typename T>
+	class MatrixView
+	{
+	private:
+
+		T* m_data = nullptr;
+		size_t m_rows = 0;
+		size_t m_dimension = 0;
+		size_t m_stride = 0;
+
+	public:
+
+		MatrixView() = default;
+
+		MatrixView(T* data, size_t rows, size_t dimension, size_t stride)
+			: m_data(data), m_rows(rows), m_dimension(dimension), m_stride(stride) {}
+
+		// tightly packed rows
+		MatrixView(T* data, size_t rows, size_t dimension)
+			: MatrixView(data, rows, dimension, dimension) {}
+
+		// a view of mutable data can be used as a view of const data
+		operator MatrixView<T const>() const { return MatrixView<T const>(m_data, m_rows, m_dimension, m_stride); }
+
+		T* operator[](size_t row) const { return m_data + row * m_stride; }
+
+		T* data() const { return m_data; }
+
+		size_t size() const { return m_rows; }
+
+		size_t dimension() const { return m_dimension; }
+
+		size_t stride() const { return m_stride; }
+
+		bool empty() const { return m_rows == 0; }
+	};
+
+
+	//======= MATRIX ============================
+
+	// owns a single aligned buffer of rows * stride elements
+	// stride is the dimension rounded up so that every row starts on a MATRIX_ALIGNMENT boundary
+	template<typename T>
+	class Matrix
+	{
+	private:
+
+		T* m_data = nullptr;
+		size_t m_rows = 0;
+		size_t m_dimension = 0;
+		size_t m_stride = 0;
+
+		static size_t padded_stride(size_t dimension)
+		{
+			constexpr size_t per_line = MATRIX_ALIGNMENT % sizeof(T) == 0 ? MATRIX_ALIGNMENT / sizeof(T) : 1;
+
+			return (dimension + per_line - 1) / per_line * per_line;
+		}
+
+		static T* allocate(size_t count)
+		{
+			if (!count)
+				return nullptr;
+
+			auto ptr = static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{ MATRIX_ALIGNMENT }));
+			std::fill(ptr, ptr + count, T{});
+
+			return ptr;
+		}
+
+		void release()
+		{
+			if (m_data)
+				::operator delete(m_data, std::align_val_t{ MATRIX_ALIGNMENT });
+
+			m_data = nullptr;
+		}
+
+	public:
+
+		Matrix() = default;
+
+		// all values are initialized to T{}
+		Matrix(size_t rows, size_t dimension)
+			: m_rows(rows), m_dimension(dimension), m_stride(padded_stride(dimension))
+		{
+			m_data = allocate(m_rows * m_stride);
+		}
+
+		Matrix(Matrix const& other)
+			: Matrix(other.m_rows, other.m_dimension)
+		{
+			std::copy(other.m_data, other.m_data + m_rows * m_stride, m_data);
+		}
+
+		Matrix(Matrix&& other) noexcept
+			: m_data(other.m_data), m_rows(other.m_rows), m_dimension(other.m_dimension), m_stride(other.m_stride)
+		{
+			other.m_data = nullptr;
+			other.m_rows = other.m_dimension = other.m_stride = 0;
+		}
+
+		// reuses the storage when the shape is unchanged
+		Matrix& operator=(Matrix const& other)
+		{
+			if (this == &other)
+				return *this;
+
+			if (m_rows == other.m_rows && m_dimension == other.m_dimension)
+			{
+				std::copy(other.m_data, other.m_data + m_rows * m_stride, m_data);
+				return *this;
+			}
+
+			Matrix copy(other);
+			*this = std::move(copy);
+
+			return *this;
+		}
+
+		Matrix& operator=(Matrix&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				m_data = other.m_data;
+				m_rows = other.m_rows;
+				m_dimension = other.m_dimension;
+				m_stride = other.m_stride;
+
+				other.m_data = nullptr;
+				other.m_rows = other.m_dimension = other.m_stride = 0;
+			}
+
+			return *this;
+		}
+
+		~Matrix() { release(); }
+
+		operator MatrixView<T>() { return view(); }
+		operator MatrixView<T const>() const { return view(); }
+
+		MatrixView<T> view() { return MatrixView<T>(m_data, m_rows, m_dimension, m_stride); }
+		MatrixView<T const> view() const { return MatrixView<T const>(m_data, m_rows, m_dimension, m_stride); }
+
+		T* operator[](size_t row) { return m_data + row * m_stride; }
+		T const* operator[](size_t row) const { return m_data + row * m_stride; }
+
+		T* data() { return m_data; }
+		T const* data() const { return m_data; }
+
+		size_t size() const { return m_rows; }
+
+		size_t dimension() const { return m_dimension; }
+
+		size_t stride() const { return m_stride; }
+
+		bool empty() const { return m_rows == 0; }
+	};
+}
@@ -0,0 +1,217 @@
+#include "model.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+
+namespace cluster
+{
+	//======= HELPERS ==============================
+
+	static bool is_valid(model_header_t const& header, size_t file_size)
+	{
+		if (std::memcmp(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0)
+			return false;
+
+		if (header.version != MODEL_VERSION || header.element_type != static_cast<uint32_t>(element_t::float64))
+			return false;
+
+		if (header.metric > static_cast<uint32_t>(metric_t::cosine))
+			return false;
+
+		if (!header.num_clusters || !header.dimension || header.stride < header.dimension)
+			return false;
+
+		if (header.centroids_offset < sizeof(model_header_t) || header.centroids_offset % sizeof(value_t) != 0 || header.centroids_offset > file_size)
+			return false;
+
+		if (header.num_clusters > (file_size - header.centroids_offset) / sizeof(value_t) / header.stride)
+			return false;
+
+		if (!header.num_labels)
+			return true;
+
+		const auto centroids_end = header.centroids_offset + header.num_clusters * header.stride * sizeof(value_t);
+
+		if (header.labels_offset < centroids_end || header.labels_offset % sizeof(uint64_t) != 0 || header.labels_offset > file_size)
+			return false;
+
+		return header.num_labels <= (file_size - header.labels_offset) / sizeof(uint64_t);
+	}
+
+
+	// values of each centroid in the file, rounded up so every centroid starts on a cache line as in value_matrix_t
+	static size_t model_stride(size_t dimension)
+	{
+		constexpr size_t per_line = MATRIX_ALIGNMENT / sizeof(value_t);
+
+		return (dimension + per_line - 1) / per_line * per_line;
+	}
+
+
+	static value_t const* row_data(value_t const* row) { return row; }
+
+	static value_t const* row_data(value_row_t const& row) { return row.data(); }
+
+
+	template<typename C>
+	static bool write_model_file(std::string const& path, C const& centroids, size_t dimension, index_list_t const& x_clusters, value_t average_distance, metric_t metric, bool with_labels)
+	{
+		const auto num_clusters = centroids.size();
+		if (!num_clusters || !dimension)
+			return false;
+
+		const auto stride = model_stride(dimension);
+		const auto num_labels = with_labels ? x_clusters.size() : 0;
+
+		model_header_t header = {};
+		std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+		header.version = MODEL_VERSION;
+		header.element_type = static_cast<uint32_t>(element_t::float64);
+		header.num_clusters = num_clusters;
+		header.dimension = dimension;
+		header.stride = stride;
+		header.num_labels = num_labels;
+		header.centroids_offset = MODEL_CENTROIDS_OFFSET;
+		header.labels_offset = num_labels ? MODEL_CENTROIDS_OFFSET + num_clusters * stride * sizeof(value_t) : 0;
+		header.average_distance = average_distance;
+		header.metric = static_cast<uint32_t>(metric);
+
+		auto file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+
+		bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+		// centroids padded with zeros
+		std::vector<value_t> row(stride, 0);
+		for (size_t k = 0; k < num_clusters && ok; ++k)
+		{
+			std::copy(row_data(centroids[k]), row_data(centroids[k]) + dimension, row.begin());
+			ok = std::fwrite(row.data(), sizeof(value_t), stride, file) == stride;
+		}
+
+		// labels as uint64_t whatever the size of size_t, a block at a time
+		constexpr size_t block_size = 4096;
+		std::vector<uint64_t> block;
+
+		for (size_t begin = 0; begin < num_labels && ok; begin += block_size)
+		{
+			const auto end = std::min(begin + block_size, num_labels);
+			block.assign(x_clusters.begin() + begin, x_clusters.begin() + end);
+
+			ok = std::fwrite(block.data(), sizeof(uint64_t), block.size(), file) == block.size();
+		}
+
+		ok = std::fclose(file) == 0 && ok;
+
+		return ok;
+	}
+
+
+	//======= MAPPED MODEL =========================
+
+	MappedModel::MappedModel(MappedModel&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+
+	MappedModel& MappedModel::operator=(MappedModel&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		m_file = std::move(other.m_file);
+		m_header = std::exchange(other.m_header, nullptr);
+		m_centroids = std::exchange(other.m_centroids, value_view_t());
+
+		return *this;
+	}
+
+
+	bool MappedModel::open(std::string const& path)
+	{
+		close();
+
+		// find_centroid reads every centroid, in no particular order
+		if (!m_file.open(path, sizeof(model_header_t), false))
+			return false;
+
+		auto const& header = *static_cast<model_header_t const*>(m_file.data());
+		if (!is_valid(header, m_file.size()))
+		{
+			close();
+			return false;
+		}
+
+		const auto centroids_size = static_cast<size_t>(header.num_clusters * header.stride * sizeof(value_t));
+		m_file.will_need(static_cast<size_t>(header.centroids_offset), centroids_size);
+
+		auto const data = reinterpret_cast<value_t const*>(static_cast<char const*>(m_file.data()) + header.centroids_offset);
+		m_centroids = value_view_t(data, header.num_clusters, header.dimension, header.stride);
+		m_header = &header;
+
+		return true;
+	}
+
+
+	void MappedModel::close()
+	{
+		m_file.close();
+		m_header = nullptr;
+		m_centroids = value_view_t();
+	}
+
+
+	uint64_t const* MappedModel::labels() const
+	{
+		if (!m_header || !m_header->num_labels)
+			return nullptr;
+
+		return reinterpret_cast<uint64_t const*>(static_cast<char const*>(m_file.data()) + m_header->labels_offset);
+	}
+
+
+	matrix_result_t MappedModel::copy_result() const
+	{
+		matrix_result_t result;
+		result.centroids = value_matrix_t(num_clusters(), dimension());
+
+		for (size_t k = 0; k < num_clusters(); ++k)
+			std::copy(m_centroids[k], m_centroids[k] + dimension(), result.centroids[k]);
+
+		if (auto const x_clusters = labels())
+			result.x_clusters.assign(x_clusters, x_clusters + num_labels());
+
+		result.average_distance = average_distance();
+
+		return result;
+	}
+
+
+	//======= FUNCTIONS =========================
+
+	bool write_model(std::string const& path, matrix_result_t const& result, metric_t metric, bool with_labels)
+	{
+		return write_model_file(path, result.centroids, result.centroids.dimension(), result.x_clusters, result.average_distance, metric, with_labels);
+	}
+
+
+	bool write_model(std::string const& path, cluster_result_t const& result, metric_t metric, bool with_labels)
+	{
+		if (result.centroids.empty())
+			return false;
+
+		const auto dimension = result.centroids[0].size();
+		for (auto const& centroid : result.centroids)
+		{
+			if (centroid.size() != dimension)
+				return false;
+		}
+
+		return write_model_file(path, result.centroids, dimension, result.x_clusters, result.average_distance, metric, with_labels);
+	}
+}
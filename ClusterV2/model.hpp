@@ -0,0 +1,102 @@
+#pragma once
+
+#include "dataset.hpp"
+#include "distance.hpp"
+
+#include <cstdint>
+#include <string>
+
+// binary model files, the result of clustering saved for inference
+// a 128 byte header, the centroids padded to cache lines like value_matrix_t, then optionally the cluster of each row
+// the file is memory mapped and used in place, so a service can answer find_centroid as soon as it is opened,
+// without parsing or copying however many clusters there are
+namespace cluster
+{
+	//======= TYPE DEFINITIONS ====================
+
+	constexpr char MODEL_MAGIC[8] = { 'K', 'M', 'E', 'A', 'N', 'S', 'M', 'D' };
+	constexpr uint32_t MODEL_VERSION = 1;
+	constexpr uint64_t MODEL_CENTROIDS_OFFSET = 128; // centroids start on a cache line
+
+
+	typedef struct ModelHeader
+	{
+		char magic[8];             // MODEL_MAGIC
+		uint32_t version;          // MODEL_VERSION
+		uint32_t element_type;     // element_t of every centroid value
+		uint64_t num_clusters;     //
+		uint64_t dimension;        // values in each centroid
+		uint64_t stride;           // values from the start of one centroid to the next
+		uint64_t num_labels;       // 0 when saved without labels
+		uint64_t centroids_offset; // bytes from the start of the file to the first centroid
+		uint64_t labels_offset;    // bytes from the start of the file to the labels, uint64_t cluster index of each row
+		double average_distance;   // of the rows from their centroids
+		uint32_t metric;           // metric_t, custom when the distance was not a built-in metric
+		uint8_t reserved[52];      // zero
+
+	} model_header_t;
+
+	static_assert(sizeof(model_header_t) == MODEL_CENTROIDS_OFFSET, "model header must fill the space before the centroids");
+
+
+	//======= CLASS DEFINITIONS =======================
+
+	// read only memory map of a model file
+	// the centroids view has the same layout as value_matrix_t, so the distance kernels see aligned rows
+	class MappedModel
+	{
+	private:
+
+		MappedFile m_file;
+		model_header_t const* m_header = nullptr;
+		value_view_t m_centroids;
+
+	public:
+
+		MappedModel() = default;
+		~MappedModel() { close(); }
+
+		MappedModel(MappedModel const&) = delete;
+		MappedModel& operator=(MappedModel const&) = delete;
+
+		MappedModel(MappedModel&& other) noexcept;
+		MappedModel& operator=(MappedModel&& other) noexcept;
+
+		// maps the file, returns false if it cannot be opened or is not a valid model
+		// the labels are not read, only the centroids are requested from disk straight away
+		bool open(std::string const& path);
+
+		void close();
+
+		bool is_open() const { return m_file.is_open(); }
+
+		size_t num_clusters() const { return m_centroids.size(); }
+
+		size_t dimension() const { return m_centroids.dimension(); }
+
+		// centroids in the file, valid until the model is closed
+		value_view_t centroids() const { return m_centroids; }
+
+		value_t average_distance() const { return m_header ? m_header->average_distance : 0; }
+
+		// the metric to give Cluster::set_metric, metric_t::custom when the model was clustered with another distance
+		metric_t metric() const { return m_header ? static_cast<metric_t>(m_header->metric) : metric_t::custom; }
+
+		size_t num_labels() const { return m_header ? static_cast<size_t>(m_header->num_labels) : 0; }
+
+		// cluster of each clustered row, nullptr when saved without labels
+		uint64_t const* labels() const;
+
+		// copies the model into a result, e.g. to carry on clustering from it
+		matrix_result_t copy_result() const;
+	};
+
+
+	//======= FUNCTIONS =========================
+
+	// writes a model file, with the cluster of each row when with_labels is set
+	// metric is only recorded for the loader, pass metric_t::custom for any other distance
+	bool write_model(std::string const& path, matrix_result_t const& result, metric_t metric, bool with_labels = false);
+
+	bool write_model(std::string const& path, cluster_result_t const& result, metric_t metric, bool with_labels = false);
+}
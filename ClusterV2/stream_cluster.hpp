@@ -0,0 +1,241 @@
+#pragma once
+
+#include "basic_cluster.hpp"
+
+#include <mutex>
+
+// online k-means over rows that keep arriving
+// centroids are updated one batch at a time with the mini-batch rule, memory does not grow with the rows seen
+// the first rows are buffered and clustered to choose the starting centroids
+namespace cluster
+{
+	//======= CLASS DEFINITION =======================
+
+	template<typename Distance = SquaredEuclidean, typename ToValue = Identity, size_t Dimension = dynamic_dimension>
+	class StreamCluster
+	{
+	private:
+
+		Distance m_distance;
+		ToValue m_to_value;
+
+		size_t m_num_clusters = 0;
+		size_t m_init_rows = 0;
+		size_t m_dimension = Dimension;
+		double m_decay = 1;
+		uint64_t m_seed = 0;
+		bool m_use_seed = false;
+		size_t m_attempts = 5;
+
+		std::shared_ptr<ThreadPool> m_pool;
+
+		std::vector<data_t> m_buffer;  // rows received before the centroids were chosen
+		value_matrix_t m_centroids;
+		std::vector<double> m_seen;    // rows each centroid has learned from
+		uint64_t m_num_rows = 0;
+
+		mutable std::mutex m_mutex;
+
+		template<typename B>
+		void learn(B const& batch_row, size_t batch_size);
+
+		uint64_t start_seed() const;
+
+		void start();
+
+	public:
+
+		// init_rows is how many rows are buffered to choose the starting centroids, at least num_clusters
+		StreamCluster(size_t num_clusters, size_t init_rows = 0, Distance const& distance = Distance(), ToValue const& to_value = ToValue())
+			: m_distance(distance), m_to_value(to_value), m_num_clusters(num_clusters), m_init_rows(std::max(init_rows ? init_rows : 16 * num_clusters, num_clusters))
+		{
+			m_pool = std::make_shared<ThreadPool>(1);
+		}
+
+		// number of threads each batch is split over
+		// 0 uses all hardware threads, 1 (default) runs on the calling thread
+		void set_threads(size_t num_threads) { m_pool = std::make_shared<ThreadPool>(num_threads); }
+
+		// how much the rows already seen count each time a batch arrives, between 0 and 1
+		// less than 1 keeps the learning rate from falling to zero so centroids follow data that drifts
+		void set_decay(double decay) { m_decay = decay; }
+
+		// makes the starting centroids repeatable, without a seed they are different every time
+		void set_seed(uint64_t seed) { m_seed = seed; m_use_seed = true; }
+
+		// clustering attempts on the buffered rows that choose the starting centroids
+		void set_attempts(size_t num_attempts) { m_attempts = std::max(num_attempts, size_t(1)); }
+
+		// learns from a batch of rows, every batch must have the same number of values in each row
+		void add_rows(data_view_t const& x_list);
+
+		void add_rows(data_row_list_t const& x_list);
+
+		// starting centroids have been chosen
+		bool is_ready() const;
+
+		// number of rows received
+		uint64_t num_rows() const;
+
+		// copy of the current centroids, empty until is_ready
+		value_matrix_t centroids() const;
+
+		// The index of the closest current centroid, is_ready must be true
+		size_t find_centroid(data_row_t const& data) const;
+
+		size_t find_centroid(data_t const* data) const;
+	};
+
+
+	//======= CLASS METHODS ==============================
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	uint64_t StreamCluster<Distance, ToValue, Dimension>::start_seed() const
+	{
+		if (m_use_seed)
+			return m_seed;
+
+		std::random_device rd;
+
+		return (static_cast<uint64_t>(rd()) << 32) | rd();
+	}
+
+
+	// clusters the buffered rows to choose the starting centroids, each centroid has then seen the rows of its cluster
+	template<typename Distance, typename ToValue, size_t Dimension>
+	void StreamCluster<Distance, ToValue, Dimension>::start()
+	{
+		const auto num_buffered = m_buffer.size() / m_dimension;
+		const data_view_t buffer(m_buffer.data(), num_buffered, m_dimension);
+
+		auto const cluster_once = [&](data_view_t const& x_list, size_t num_clusters, uint64_t seed)
+		{
+			return algorithms::cluster_once<matrix_result_t, Dimension>(x_list, num_clusters, m_distance, m_to_value, seed, seeding_t::kmeans_pp, *m_pool);
+		};
+
+		static ThreadPool serial(1);
+		auto result = algorithms::cluster_min_distance(buffer, m_num_clusters, cluster_once, serial, start_seed(), m_attempts);
+
+		m_centroids = std::move(result.centroids);
+		m_seen.assign(m_num_clusters, 0);
+		for (auto const k : result.x_clusters)
+			++m_seen[k];
+
+		m_buffer = std::vector<data_t>();
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	template<typename B>
+	void StreamCluster<Distance, ToValue, Dimension>::learn(B const& batch_row, size_t batch_size)
+	{
+		std::vector<algorithms::cluster_sums_t<value_matrix_t>> range_sums;
+
+		algorithms::total_batch<Dimension>(batch_row, batch_size, m_centroids, m_distance, m_to_value, *m_pool, range_sums);
+
+		for (auto& seen : m_seen)
+			seen *= m_decay;
+
+		algorithms::learn_batch<Dimension>(m_centroids, m_seen, range_sums);
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	void StreamCluster<Distance, ToValue, Dimension>::add_rows(data_view_t const& x_list)
+	{
+		if (x_list.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_dimension == dynamic_dimension)
+			m_dimension = x_list.dimension();
+
+		m_num_rows += x_list.size();
+
+		if (!m_centroids.empty())
+		{
+			learn([&](size_t b) { return x_list[b]; }, x_list.size());
+			return;
+		}
+
+		for (size_t i = 0; i < x_list.size(); ++i)
+			m_buffer.insert(m_buffer.end(), x_list[i], x_list[i] + m_dimension);
+
+		if (m_buffer.size() / m_dimension >= m_init_rows)
+			start();
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	void StreamCluster<Distance, ToValue, Dimension>::add_rows(data_row_list_t const& x_list)
+	{
+		if (x_list.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_dimension == dynamic_dimension)
+			m_dimension = x_list[0].size();
+
+		m_num_rows += x_list.size();
+
+		if (!m_centroids.empty())
+		{
+			learn([&](size_t b) { return x_list[b].data(); }, x_list.size());
+			return;
+		}
+
+		for (auto const& row : x_list)
+			m_buffer.insert(m_buffer.end(), row.begin(), row.begin() + m_dimension);
+
+		if (m_buffer.size() / m_dimension >= m_init_rows)
+			start();
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	bool StreamCluster<Distance, ToValue, Dimension>::is_ready() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return !m_centroids.empty();
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	uint64_t StreamCluster<Distance, ToValue, Dimension>::num_rows() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return m_num_rows;
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	value_matrix_t StreamCluster<Distance, ToValue, Dimension>::centroids() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return m_centroids;
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	size_t StreamCluster<Distance, ToValue, Dimension>::find_centroid(data_row_t const& data) const
+	{
+		return find_centroid(data.data());
+	}
+
+
+	template<typename Distance, typename ToValue, size_t Dimension>
+	size_t StreamCluster<Distance, ToValue, Dimension>::find_centroid(data_t const* data) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		value_view_t centroids = m_centroids;
+		auto result = algorithms::closest<Dimension>(m_distance, data, centroids);
+
+		return result.index;
+	}
+}
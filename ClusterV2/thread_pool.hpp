@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+namespace cluster
+{
+	//======= THREAD POOL =======================
+
+	// fixed set of worker threads that run batches of independent tasks
+	// the calling thread also takes tasks, so a pool of 1 thread runs everything on the caller
+	// run() called from inside a task executes the nested batch serially on that thread
+	class ThreadPool
+	{
+	public:
+
+		using task_t = std::function<void(size_t task_id)>;
+
+	private:
+
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_run_mutex; // one batch at a time when the pool is shared
+		std::mutex m_mutex;
+		std::condition_variable m_start;
+		std::condition_variable m_done;
+
+		task_t const* m_task = nullptr;
+		size_t m_num_tasks = 0;
+		std::atomic<size_t> m_next{ 0 };
+		size_t m_busy = 0;
+		size_t m_batch = 0;
+		bool m_stop = false;
+		std::exception_ptr m_error;
+
+		static bool& in_task()
+		{
+			thread_local bool flag = false;
+			return flag;
+		}
+
+		// takes task ids until the batch is exhausted
+		void drain(task_t const& task, size_t num_tasks)
+		{
+			auto& flag = in_task();
+			flag = true;
+
+			for (auto id = m_next++; id < num_tasks; id = m_next++)
+			{
+				try
+				{
+					task(id);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_error)
+						m_error = std::current_exception();
+				}
+			}
+
+			flag = false;
+		}
+
+		void work()
+		{
+			size_t batch = 0;
+
+			for (;;)
+			{
+				task_t const* task = nullptr;
+				size_t num_tasks = 0;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_start.wait(lock, [&]() { return m_stop || m_batch != batch; });
+
+					if (m_stop)
+						return;
+
+					batch = m_batch;
+					task = m_task;
+					num_tasks = m_num_tasks;
+
+					if (!task) // woke up after the batch was already finished
+						continue;
+
+					++m_busy;
+				}
+
+				drain(*task, num_tasks);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (--m_busy == 0)
+					m_done.notify_all();
+			}
+		}
+
+	public:
+
+		// num_threads includes the calling thread
+		// 0 uses one thread per hardware thread
+		explicit ThreadPool(size_t num_threads)
+		{
+			if (num_threads == 0)
+				num_threads = std::thread::hardware_concurrency();
+
+			for (size_t i = 1; i < num_threads; ++i)
+				m_workers.emplace_back([this]() { work(); });
+		}
+
+		ThreadPool(ThreadPool const&) = delete;
+		ThreadPool& operator=(ThreadPool const&) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+
+			m_start.notify_all();
+
+			for (auto& worker : m_workers)
+				worker.join();
+		}
+
+		size_t size() const { return m_workers.size() + 1; }
+
+		// calls task(i) for each i in [0, num_tasks) and waits for all of them to finish
+		// rethrows the first exception thrown by a task
+		void run(size_t num_tasks, task_t const& task)
+		{
+			if (m_workers.empty() || num_tasks < 2 || in_task())
+			{
+				for (size_t i = 0; i < num_tasks; ++i)
+					task(i);
+
+				return;
+			}
+
+			std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_task = &task;
+			m_num_tasks = num_tasks;
+			m_next = 0;
+			m_error = nullptr;
+			++m_batch;
+			lock.unlock();
+
+			m_start.notify_all();
+			drain(task, num_tasks);
+
+			lock.lock();
+			m_done.wait(lock, [&]() { return m_busy == 0; });
+
+			m_task = nullptr;
+			auto error = m_error;
+			m_error = nullptr;
+			lock.unlock();
+
+			if (error)
+				std::rethrow_exception(error);
+		}
+	};
+}
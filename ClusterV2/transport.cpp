@@ -0,0 +1,294 @@
+#include "transport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32.lib")
+
+#else
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif
+
+
+namespace cluster
+{
+	//======= HELPERS ==============================
+
+#ifdef _WIN32
+
+	static const intptr_t invalid_socket = static_cast<intptr_t>(INVALID_SOCKET);
+	static const int send_flags = 0;
+
+	static bool start_sockets()
+	{
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+
+	static void close_socket(intptr_t socket)
+	{
+		closesocket(static_cast<SOCKET>(socket));
+	}
+
+#else
+
+	static const intptr_t invalid_socket = -1;
+	static const int send_flags = MSG_NOSIGNAL; // a closed connection fails the send instead of raising SIGPIPE
+
+	static bool start_sockets()
+	{
+		return true;
+	}
+
+	static void close_socket(intptr_t socket)
+	{
+		::close(static_cast<int>(socket));
+	}
+
+#endif
+
+
+	// small messages are sent at once rather than waiting to be combined
+	static void set_no_delay(intptr_t socket)
+	{
+		int flag = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const*>(&flag), sizeof(flag));
+	}
+
+
+	typedef struct Hello
+	{
+		uint64_t rank;
+		uint64_t num_processes;
+
+	} hello_t;
+
+
+	//======= SOCKET TRANSPORT =======================
+
+	bool SocketTransport::send_all(intptr_t socket, void const* data, size_t size) const
+	{
+		auto bytes = static_cast<char const*>(data);
+
+		while (size)
+		{
+			const auto chunk = static_cast<int>(std::min(size, size_t(1) << 30));
+			const auto sent = send(socket, bytes, chunk, send_flags);
+			if (sent <= 0)
+				return false;
+
+			bytes += sent;
+			size -= static_cast<size_t>(sent);
+		}
+
+		return true;
+	}
+
+
+	bool SocketTransport::receive_all(intptr_t socket, void* data, size_t size) const
+	{
+		auto bytes = static_cast<char*>(data);
+
+		while (size)
+		{
+			const auto chunk = static_cast<int>(std::min(size, size_t(1) << 30));
+			const auto received = recv(socket, bytes, chunk, 0);
+			if (received <= 0)
+				return false;
+
+			bytes += received;
+			size -= static_cast<size_t>(received);
+		}
+
+		return true;
+	}
+
+
+	bool SocketTransport::open_root(uint16_t port, size_t num_processes)
+	{
+		close();
+
+		if (!num_processes || !start_sockets())
+			return false;
+
+		m_rank = 0;
+		m_size = num_processes;
+		m_sockets.assign(num_processes, invalid_socket);
+
+		if (num_processes == 1)
+			return true;
+
+		const intptr_t listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listener == invalid_socket)
+		{
+			close();
+			return false;
+		}
+
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&reuse), sizeof(reuse));
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons(port);
+
+		bool ok = bind(listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0
+			&& listen(listener, static_cast<int>(num_processes)) == 0;
+
+		// workers can connect in any order, each says which rank it is
+		for (size_t connected = 1; ok && connected < num_processes; ++connected)
+		{
+			const intptr_t worker = accept(listener, nullptr, nullptr);
+			if (worker == invalid_socket)
+			{
+				ok = false;
+				break;
+			}
+
+			hello_t hello;
+			const bool valid = receive_all(worker, &hello, sizeof(hello))
+				&& hello.num_processes == num_processes && hello.rank > 0 && hello.rank < num_processes
+				&& m_sockets[hello.rank] == invalid_socket;
+
+			if (!valid)
+			{
+				close_socket(worker);
+				ok = false;
+				break;
+			}
+
+			set_no_delay(worker);
+			m_sockets[hello.rank] = worker;
+		}
+
+		close_socket(listener);
+
+		if (!ok)
+			close();
+
+		return ok;
+	}
+
+
+	bool SocketTransport::open_worker(std::string const& host, uint16_t port, size_t rank, size_t num_processes, unsigned timeout_ms)
+	{
+		close();
+
+		if (rank == 0 || rank >= num_processes || !start_sockets())
+			return false;
+
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo* addresses = nullptr;
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+			return false;
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		intptr_t root = invalid_socket;
+
+		// the root may not be listening yet
+		while (root == invalid_socket)
+		{
+			for (auto address = addresses; address && root == invalid_socket; address = address->ai_next)
+			{
+				root = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+				if (root == invalid_socket)
+					continue;
+
+				if (connect(root, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0)
+				{
+					close_socket(root);
+					root = invalid_socket;
+				}
+			}
+
+			if (root != invalid_socket || std::chrono::steady_clock::now() >= deadline)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+
+		freeaddrinfo(addresses);
+
+		if (root == invalid_socket)
+			return false;
+
+		set_no_delay(root);
+
+		const hello_t hello = { rank, num_processes };
+		if (!send_all(root, &hello, sizeof(hello)))
+		{
+			close_socket(root);
+			return false;
+		}
+
+		m_rank = rank;
+		m_size = num_processes;
+		m_sockets.assign(1, root);
+
+		return true;
+	}
+
+
+	void SocketTransport::close()
+	{
+		for (auto const socket : m_sockets)
+		{
+			if (socket != invalid_socket)
+				close_socket(socket);
+		}
+
+		m_sockets.clear();
+		m_rank = 0;
+		m_size = 1;
+	}
+
+
+	bool SocketTransport::all_reduce(double* values, size_t count)
+	{
+		if (!is_open())
+			return false;
+
+		const auto size = count * sizeof(double);
+
+		if (m_rank)
+			return send_all(m_sockets[0], values, size) && receive_all(m_sockets[0], values, size);
+
+		m_buffer.resize(count);
+
+		for (size_t r = 1; r < m_size; ++r)
+		{
+			if (!receive_all(m_sockets[r], m_buffer.data(), size))
+				return false;
+
+			for (size_t i = 0; i < count; ++i)
+				values[i] += m_buffer[i];
+		}
+
+		for (size_t r = 1; r < m_size; ++r)
+		{
+			if (!send_all(m_sockets[r], values, size))
+				return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// how the processes of a distributed clustering exchange their cluster totals
+// only totals the size of the centroids are sent each iteration, never the rows
+namespace cluster
+{
+	//======= CLASS DEFINITIONS =======================
+
+	// every process calls each operation in the same order with the same count
+	class Transport
+	{
+	public:
+
+		virtual ~Transport() = default;
+
+		// this process, 0 is the root
+		virtual size_t rank() const = 0;
+
+		// number of processes
+		virtual size_t size() const = 0;
+
+		// sums values element-wise over all processes, every process receives the same totals
+		// returns false if the exchange failed
+		virtual bool all_reduce(double* values, size_t count) = 0;
+	};
+
+
+	// single process, all_reduce leaves the values as they are
+	class LocalTransport : public Transport
+	{
+	public:
+
+		size_t rank() const override { return 0; }
+
+		size_t size() const override { return 1; }
+
+		bool all_reduce(double*, size_t) override { return true; }
+	};
+
+
+	// tcp connections between the root and every other process
+	// the root adds the values of the processes in rank order and sends the totals back,
+	// so every process gets the same bits whatever order the values arrive in
+	class SocketTransport : public Transport
+	{
+	private:
+
+		size_t m_rank = 0;
+		size_t m_size = 1;
+
+		std::vector<intptr_t> m_sockets; // the root's connection to each rank, or a worker's connection to the root
+		std::vector<double> m_buffer;
+
+		bool send_all(intptr_t socket, void const* data, size_t size) const;
+
+		bool receive_all(intptr_t socket, void* data, size_t size) const;
+
+	public:
+
+		SocketTransport() = default;
+		~SocketTransport() { close(); }
+
+		SocketTransport(SocketTransport const&) = delete;
+		SocketTransport& operator=(SocketTransport const&) = delete;
+
+		// root: listens on the port and waits until num_processes - 1 workers have connected
+		bool open_root(uint16_t port, size_t num_processes);
+
+		// worker: connects to the root, retrying for up to timeout_ms while the root starts
+		bool open_worker(std::string const& host, uint16_t port, size_t rank, size_t num_processes, unsigned timeout_ms = 10000);
+
+		void close();
+
+		bool is_open() const { return !m_sockets.empty(); }
+
+		size_t rank() const override { return m_rank; }
+
+		size_t size() const override { return m_size; }
+
+		bool all_reduce(double* values, size_t count) override;
+	};
+}